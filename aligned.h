@@ -0,0 +1,61 @@
+#pragma once
+
+#include <memory>
+#include <new>
+#include <cstddef>
+#include <cstdlib>
+#if defined(_WIN32)
+# include <malloc.h>
+#endif
+
+namespace beluga {
+
+// The heap memory aligned for the over-aligned types,
+// because operator new of C++11 only guarantees alignof(std::max_align_t).
+inline void* AlignedAlloc(size_t size, size_t alignment) {
+#if defined(_WIN32)
+  void* p = _aligned_malloc(size, alignment);
+#else
+  void* p = nullptr;
+  if (posix_memalign(&p, alignment < sizeof(void*) ? sizeof(void*) : alignment, size) != 0) {
+    p = nullptr;
+  }
+#endif
+  if (p == nullptr) {
+    throw std::bad_alloc();
+  }
+  return p;
+}
+
+inline void AlignedFree(void* p) {
+#if defined(_WIN32)
+  _aligned_free(p);
+#else
+  free(p);
+#endif
+}
+
+template <class T>
+struct AlignedDeleter {
+  void operator()(T* p) const {
+    p->~T();
+    AlignedFree(p);
+  }
+};
+
+template <class T>
+using AlignedPtr = std::unique_ptr<T, AlignedDeleter<T>>;
+
+// The value-initialized T, like new T().
+template <class T>
+AlignedPtr<T> MakeAligned() {
+  void* p = AlignedAlloc(sizeof(T), alignof(T));
+  try {
+    return AlignedPtr<T>(new (p) T());
+  } catch (...) {
+    AlignedFree(p);
+    throw;
+  }
+}
+
+} // namespace beluga
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstdint>
+
+#if defined(_MSC_VER)
+# include <intrin.h>
+# include <xmmintrin.h>
+#endif
+
+// Hardware instructions are used only when the compiler is allowed to emit them.
+// (e.g. make POPCNT=1 BMI2=1, or /arch:AVX2 on Visual Studio)
+// The startup check in cpu.cpp stops the binaries on the CPUs without them.
+#if !defined(BELUGA_POPCNT)
+# if defined(__POPCNT__) || (defined(_MSC_VER) && defined(_M_X64) && defined(__AVX__))
+#  define BELUGA_POPCNT 1
+# else
+#  define BELUGA_POPCNT 0
+# endif
+#endif
+
+#if !defined(BELUGA_BMI2)
+# if defined(__BMI2__) || (defined(_MSC_VER) && defined(_M_X64) && defined(__AVX2__))
+#  define BELUGA_BMI2 1
+# else
+#  define BELUGA_BMI2 0
+# endif
+#endif
+
+#if BELUGA_POPCNT || BELUGA_BMI2
+# include <immintrin.h>
+#endif
+
+namespace beluga {
+
+inline int PopCount(uint64_t x) {
+#if BELUGA_POPCNT
+  return static_cast<int>(_mm_popcnt_u64(x));
+#else
+  x = x - ((x >> 1) & 0x5555555555555555llu);
+  x = (x & 0x3333333333333333llu) + ((x >> 2) & 0x3333333333333333llu);
+  x = (x + (x >> 4)) & 0x0F0F0F0F0F0F0F0Fllu;
+  x = x + (x >> 8);
+  x = x + (x >> 16);
+  x = x + (x >> 32);
+  return static_cast<int>(x & 0x000000000000007Fllu);
+#endif
+}
+
+// x must not be zero.
+inline int CountTrailingZeros(uint64_t x) {
+#if defined(_MSC_VER) && defined(_M_X64)
+  unsigned long index;
+  _BitScanForward64(&index, x);
+  return static_cast<int>(index);
+#elif defined(__GNUC__)
+  return __builtin_ctzll(x);
+#else
+  return PopCount((x & (~x + 1)) - 1);
+#endif
+}
+
+inline void Prefetch(const void* addr) {
+#if defined(_MSC_VER)
+  _mm_prefetch(static_cast<const char*>(addr), _MM_HINT_T0);
+#else
+  __builtin_prefetch(addr);
+#endif
+}
+
+inline uint64_t ClearLowestBit(uint64_t x) {
+  return x & (x - 1);
+}
+
+// Gathers the bits of x selected by mask into the low bits.
+inline uint64_t ParallelExtract(uint64_t x, uint64_t mask) {
+#if BELUGA_BMI2
+  return _pext_u64(x, mask);
+#else
+  uint64_t result = 0;
+  for (uint64_t bit = 1; mask != 0; bit <<= 1) {
+    if (x & mask & (~mask + 1)) {
+      result |= bit;
+    }
+    mask = ClearLowestBit(mask);
+  }
+  return result;
+#endif
+}
+
+} // namespace beluga
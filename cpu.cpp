@@ -0,0 +1,103 @@
+#include "cpu.h"
+#include "bitop.h"
+#include <cstdio>
+#include <cstdlib>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+# include <intrin.h>
+# define BELUGA_CPUID 1
+#elif defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+# include <cpuid.h>
+# define BELUGA_CPUID 1
+#else
+# define BELUGA_CPUID 0
+#endif
+
+namespace {
+
+#if BELUGA_CPUID
+
+void Cpuid(int leaf, int subleaf, unsigned regs[4]) {
+#if defined(_MSC_VER)
+  int r[4];
+  __cpuidex(r, leaf, subleaf);
+  for (int i = 0; i < 4; i++) {
+    regs[i] = static_cast<unsigned>(r[i]);
+  }
+#else
+  __cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+unsigned long long Xgetbv() {
+#if defined(_MSC_VER)
+  return _xgetbv(0);
+#else
+  unsigned eax, edx;
+  __asm__ volatile ("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+  return (static_cast<unsigned long long>(edx) << 32) | eax;
+#endif
+}
+
+#endif
+
+beluga::CpuFeatures DetectCpuFeatures() {
+  beluga::CpuFeatures features = { false, false, false, false };
+
+#if BELUGA_CPUID
+  unsigned regs[4];
+
+  Cpuid(0, 0, regs);
+  unsigned maxLeaf = regs[0];
+  features.intel = regs[1] == 0x756e6547 && regs[3] == 0x49656e69 && regs[2] == 0x6c65746e; // "GenuineIntel"
+  if (maxLeaf < 1) {
+    return features;
+  }
+
+  Cpuid(1, 0, regs);
+  features.popcnt = (regs[2] & (1u << 23)) != 0;
+  bool osxsave    = (regs[2] & (1u << 27)) != 0;
+  bool avx        = (regs[2] & (1u << 28)) != 0;
+
+  // YMM registers have to be saved by the OS
+  bool ymm = osxsave && avx && (Xgetbv() & 0x6) == 0x6;
+
+  if (maxLeaf >= 7) {
+    Cpuid(7, 0, regs);
+    features.bmi2 = (regs[1] & (1u << 8)) != 0;
+    features.avx2 = ymm && (regs[1] & (1u << 5)) != 0;
+  }
+#endif
+
+  return features;
+}
+
+// PopCount and ParallelExtract are inlined everywhere, so the instructions enabled by the build
+// are not dispatched at runtime. Instead, the binary stops before they are executed on a CPU
+// without them, which is before the tables built during static initialization.
+struct RequiredFeatureCheck {
+  RequiredFeatureCheck() {
+    const beluga::CpuFeatures& features = beluga::GetCpuFeatures();
+    if ((BELUGA_POPCNT && !features.popcnt) || (BELUGA_BMI2 && !features.bmi2)) {
+      fputs("ERROR: This binary is built for the POPCNT or BMI2 instructions, which this CPU does not support\n", stderr);
+      std::abort();
+    }
+  }
+};
+
+#if defined(__GNUC__)
+RequiredFeatureCheck requiredFeatureCheck __attribute__((init_priority(101)));
+#else
+RequiredFeatureCheck requiredFeatureCheck;
+#endif
+
+} // namespace
+
+namespace beluga {
+
+const CpuFeatures& GetCpuFeatures() {
+  static const CpuFeatures features = DetectCpuFeatures();
+  return features;
+}
+
+} // namespace beluga
@@ -0,0 +1,26 @@
+#pragma once
+
+// The AVX2 kernels are built on x86-64 and selected at runtime by GetCpuFeatures.
+#if !defined(BELUGA_AVX2)
+# if defined(__x86_64__) || defined(_M_X64)
+#  define BELUGA_AVX2 1
+# else
+#  define BELUGA_AVX2 0
+# endif
+#endif
+
+namespace beluga {
+
+struct CpuFeatures {
+  // required by the binaries built with POPCNT=1 or BMI2=1 (see bitop.h)
+  bool popcnt;
+  bool bmi2;
+  bool avx2;
+
+  // for the vendor specific performance counters
+  bool intel;
+};
+
+const CpuFeatures& GetCpuFeatures();
+
+} // namespace beluga
@@ -0,0 +1,665 @@
+#include "evaluate.h"
+#include "reversi.h"
+#include "network.h"
+#include "search.h"
+#include "cpu.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__)
+# include <linux/perf_event.h>
+# include <sys/ioctl.h>
+# include <sys/syscall.h>
+# include <unistd.h>
+#endif
+
+using namespace beluga;
+
+namespace {
+
+// Generates boards by random playouts from the normal initial board.
+std::vector<Board> GenerateBoards(size_t count, uint32_t seed) {
+  std::mt19937 rng(seed);
+  std::vector<Board> boards;
+  boards.reserve(count);
+  while (boards.size() < count) {
+    Board board = Board::GetNormalInitBoard();
+    while (!board.IsEnd() && boards.size() < count) {
+      if (board.MustPass()) {
+        board.Pass();
+        continue;
+      }
+      boards.push_back(board);
+
+      Bitboard moves = board.GenerateMoves();
+      int n = static_cast<int>(rng() % moves.Count());
+      for (Square move : moves) {
+        if (n-- == 0) {
+          board.DoMove(move);
+          break;
+        }
+      }
+    }
+  }
+  return boards;
+}
+
+// Loads eval.bin, or initializes the weights randomly if it is not found.
+std::shared_ptr<Evaluator> LoadEvaluator() {
+  std::shared_ptr<Evaluator> eval(new Evaluator);
+  if (eval->LoadParam() != nullptr) {
+    std::cout << "eval.bin has not loaded, and initialized by random weights" << std::endl;
+    std::mt19937 rng(3);
+    std::normal_distribution<float> d(0.0f, 300.0f);
+    Score* weights = reinterpret_cast<Score*>(&eval->GetParameters());
+    for (size_t i = 0; i < sizeof(FeatureParameters<Score>) / sizeof(Score); i++) {
+      weights[i] = static_cast<Score>(std::max(-4000.0f, std::min(4000.0f, d(rng))));
+    }
+    eval->Symmetrize();
+  }
+  return eval;
+}
+
+// Loads network.bin, or initializes the weights randomly if it is not found.
+std::shared_ptr<Network> LoadNetwork() {
+  std::shared_ptr<Network> network(new Network);
+  if (network->LoadParam() != nullptr) {
+    std::cout << "network.bin has not loaded, and initialized by random weights" << std::endl;
+    network->InitRandom(7);
+  }
+  return network;
+}
+
+// Compares the accumulators and the feature indices updated move by move in random games,
+// and restored by the moves undone, with those computed from the boards.
+size_t CheckNetwork(size_t count) {
+  std::shared_ptr<Network> network = LoadNetwork();
+  std::mt19937 rng(8);
+  size_t errors = 0;
+  size_t checked = 0;
+  while (checked < count) {
+    // a pass is recorded with an empty mask
+    struct Move {
+      Board board;
+      Square square;
+      Bitboard mask;
+    };
+    std::vector<Move> moves;
+    Board board = Board::GetNormalInitBoard();
+    NetworkAccumulator accumulator(*network, board);
+    FeatureIndices indices(board);
+    while (!board.IsEnd()) {
+      if (board.MustPass()) {
+        moves.push_back({ board, Square(), Bitboard() });
+        board.Pass();
+        accumulator.Pass();
+        indices.Pass();
+        continue;
+      }
+      Bitboard legal = board.GenerateMoves();
+      int n = static_cast<int>(rng() % legal.Count());
+      for (Square square : legal) {
+        if (n-- == 0) {
+          Bitboard mask = PlayerBoard(board).GetFlipMask(square);
+          moves.push_back({ board, square, mask });
+          accumulator.DoMove(*network, square, mask);
+          indices.DoMove(square, mask);
+          board.DoMove(square);
+          break;
+        }
+      }
+      if (!accumulator.Verify(*network, PlayerBoard(board)) || !indices.Verify(PlayerBoard(board))) {
+        errors++;
+      }
+      checked++;
+    }
+    while (!moves.empty()) {
+      const Move& move = moves.back();
+      if (move.mask == Bitboard()) {
+        accumulator.Pass();
+        indices.Pass();
+      } else {
+        accumulator.UndoMove(*network, move.square, move.mask);
+        indices.UndoMove(move.square, move.mask);
+      }
+      if (!accumulator.Verify(*network, PlayerBoard(move.board)) || !indices.Verify(PlayerBoard(move.board))) {
+        errors++;
+      }
+      moves.pop_back();
+    }
+  }
+  return errors;
+}
+
+// Compares the feature indices with the square by square extraction,
+// the batch evaluation and gradient with those of each board,
+// and the incremental accumulators of the network.
+int Check(size_t count) {
+  size_t errors = 0;
+  std::vector<Board> boards = GenerateBoards(count, 1);
+  for (const Board& board : boards) {
+    if (!FeatureIndices(board).Verify(PlayerBoard(board))) {
+      errors++;
+    }
+  }
+
+  std::shared_ptr<Evaluator> eval = LoadEvaluator();
+  std::mt19937 rng(6);
+  std::uniform_int_distribution<int> d(-300, 300);
+  Score* globalWeights = reinterpret_cast<Score*>(&eval->GetGlobalParameters());
+  for (int i = 0; i < GlobalParameterCount; i++) {
+    globalWeights[i] = static_cast<Score>(d(rng));
+  }
+
+  for (int mode = 0; mode < 5; mode++) {
+    // the int16 weights, with the global weights, the int8 weights with the global weights,
+    // and the int16 and int8 weights of the stages with the global weights
+    if (mode == 1) {
+      eval->EnableGlobalFeatures(true);
+    } else if (mode == 2) {
+      eval->Quantize();
+    } else if (mode == 3) {
+      eval->SplitStages();
+      for (int stage = 0; stage < StageCount; stage++) {
+        Score* weights = reinterpret_cast<Score*>(&eval->GetParameters(stage));
+        for (size_t i = 0; i < sizeof(FeatureParameters<Score>) / sizeof(Score); i += 7) {
+          weights[i] = static_cast<Score>(weights[i] + d(rng));
+        }
+      }
+      eval->Symmetrize();
+    } else if (mode == 4) {
+      eval->Quantize();
+    }
+    std::vector<Score> scores(boards.size());
+    eval->Evaluate(boards.data(), boards.size(), scores.data());
+    for (size_t i = 0; i < boards.size(); i++) {
+      if (scores[i] != eval->Evaluate(boards[i])) {
+        errors++;
+      }
+    }
+  }
+
+  // the gradients are multiples of 1/64, so both sums are exact
+  const size_t gradientCount = std::min<size_t>(boards.size(), 10000);
+  std::vector<float> gradients(gradientCount);
+  for (int stageCount : { 1, StageCount }) {
+    Gradient single(stageCount);
+    for (size_t i = 0; i < gradientCount; i++) {
+      gradients[i] = static_cast<float>(static_cast<int>(i % 7) - 3) / 64.0f;
+      single.Add(boards[i], gradients[i]);
+    }
+    Gradient batch(stageCount);
+    batch.Add(boards.data(), gradients.data(), gradientCount);
+    for (size_t i = 0; i < single.GetSize(); i++) {
+      if (single.Get(i) != batch.Get(i)) {
+        errors++;
+      }
+    }
+  }
+
+  errors += CheckNetwork(count);
+
+  std::cout << "check: " << count << " boards " << (errors == 0 ? "OK" : "NG") << std::endl;
+  return errors == 0 ? 0 : 1;
+}
+
+// Counts the L2 references and misses of this thread with the Intel L2_RQSTS events.
+// The rate is not available on other platforms, or when the counters are not permitted.
+class L2Counter {
+public:
+
+  L2Counter() : references_(-1), misses_(-1) {
+#if defined(__linux__)
+    if (GetCpuFeatures().intel) {
+      references_ = Open(0xff24); // L2_RQSTS.REFERENCES
+      misses_ = Open(0x3f24);     // L2_RQSTS.MISS
+    }
+#endif
+  }
+
+  ~L2Counter() {
+#if defined(__linux__)
+    if (references_ >= 0) {
+      close(references_);
+    }
+    if (misses_ >= 0) {
+      close(misses_);
+    }
+#endif
+  }
+
+  bool IsAvailable() const {
+    return references_ >= 0 && misses_ >= 0;
+  }
+
+  void Start() {
+#if defined(__linux__)
+    if (IsAvailable()) {
+      ioctl(references_, PERF_EVENT_IOC_RESET, 0);
+      ioctl(misses_, PERF_EVENT_IOC_RESET, 0);
+      ioctl(references_, PERF_EVENT_IOC_ENABLE, 0);
+      ioctl(misses_, PERF_EVENT_IOC_ENABLE, 0);
+    }
+#endif
+  }
+
+  // returns the miss rate since Start, or a negative value
+  double Stop() {
+#if defined(__linux__)
+    if (IsAvailable()) {
+      ioctl(references_, PERF_EVENT_IOC_DISABLE, 0);
+      ioctl(misses_, PERF_EVENT_IOC_DISABLE, 0);
+      uint64_t references = 0;
+      uint64_t misses = 0;
+      if (read(references_, &references, sizeof(references)) == sizeof(references)
+       && read(misses_, &misses, sizeof(misses)) == sizeof(misses)
+       && references != 0) {
+        return static_cast<double>(misses) / static_cast<double>(references);
+      }
+    }
+#endif
+    return -1.0;
+  }
+
+private:
+
+#if defined(__linux__)
+  static int Open(uint64_t config) {
+    perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_RAW;
+    attr.config = config;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    return static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0));
+  }
+#endif
+
+  int references_;
+  int misses_;
+
+};
+
+void Print(const char* name, double evals, double elapsed, double missRate) {
+  std::cout << name << ": "
+            << std::setw(8) << std::fixed << std::setprecision(2) << (elapsed > 0.0 ? evals / elapsed * 1e-6 : 0.0) << " Mevals/sec  L2 miss rate ";
+  if (missRate >= 0.0) {
+    std::cout << std::setprecision(2) << missRate * 100.0 << "%";
+  } else {
+    std::cout << "n/a";
+  }
+  std::cout << std::endl;
+}
+
+// Evaluates all boards repeatedly from the feature indices, and prints evals/sec and the L2 miss rate.
+Score Measure(const char* name, const Evaluator& eval, const std::vector<FeatureIndices>& indices, int passes) {
+  L2Counter counter;
+  Score sum = 0;
+
+  counter.Start();
+  auto start = std::chrono::steady_clock::now();
+  for (int pass = 0; pass < passes; pass++) {
+    for (const auto& fi : indices) {
+      sum += eval.Evaluate(fi);
+    }
+  }
+  auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  double missRate = counter.Stop();
+
+  double evals = static_cast<double>(indices.size()) * passes;
+  Print(name, evals, elapsed, missRate);
+  return sum;
+}
+
+// Evaluates all boards repeatedly one by one from the boards, which extracts the features
+// like the batch evaluation does.
+Score MeasureBoards(const char* name, const Evaluator& eval, const std::vector<Board>& boards, int passes) {
+  L2Counter counter;
+  Score sum = 0;
+
+  counter.Start();
+  auto start = std::chrono::steady_clock::now();
+  for (int pass = 0; pass < passes; pass++) {
+    for (const auto& board : boards) {
+      sum += eval.Evaluate(board);
+    }
+  }
+  auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  double missRate = counter.Stop();
+
+  Print(name, static_cast<double>(boards.size()) * passes, elapsed, missRate);
+  return sum;
+}
+
+// Evaluates all boards repeatedly with the batch evaluation.
+Score MeasureBatch(const char* name, const Evaluator& eval, const std::vector<Board>& boards, int passes) {
+  L2Counter counter;
+  std::vector<Score> scores(boards.size());
+  Score sum = 0;
+
+  counter.Start();
+  auto start = std::chrono::steady_clock::now();
+  for (int pass = 0; pass < passes; pass++) {
+    eval.Evaluate(boards.data(), boards.size(), scores.data());
+    sum += scores[pass % scores.size()];
+  }
+  auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  double missRate = counter.Stop();
+
+  Print(name, static_cast<double>(boards.size()) * passes, elapsed, missRate);
+  return sum;
+}
+
+// Compares the int16 and int8 layouts with eval.bin, or with random weights if it is not found.
+int Speed(size_t count) {
+  std::shared_ptr<Evaluator> eval = LoadEvaluator();
+
+  // the boards are shuffled so that consecutive boards do not share the weights
+  std::vector<Board> boards = GenerateBoards(count, 2);
+  std::shuffle(boards.begin(), boards.end(), std::mt19937(4));
+  std::vector<FeatureIndices> indices(boards.begin(), boards.end());
+
+  std::vector<Score> exact;
+  for (const auto& fi : indices) {
+    exact.push_back(eval->Evaluate(fi));
+  }
+
+  // "indices" starts from the extracted features like the search, while "boards" and "batch"
+  // both extract them from the boards, and are compared with each other.
+  const int passes = static_cast<int>(std::max<size_t>(1, 10000000 / count));
+  Score sum = Measure("int16 indices ", *eval, indices, passes);
+  sum += MeasureBoards("int16 boards  ", *eval, boards, passes);
+  sum += MeasureBatch("int16 batch   ", *eval, boards, passes);
+
+  eval->Quantize();
+  sum += Measure("int8 indices  ", *eval, indices, passes);
+  sum += MeasureBoards("int8 boards   ", *eval, boards, passes);
+  sum += MeasureBatch("int8 batch    ", *eval, boards, passes);
+
+  // the gradient of the training, from the boards in both ways
+  const int gradientPasses = std::max(1, passes / 4);
+  std::vector<float> gradients(boards.size(), 1.0f);
+  Gradient gradient(eval->GetStageCount());
+  auto gradientStart = std::chrono::steady_clock::now();
+  for (int pass = 0; pass < gradientPasses; pass++) {
+    for (const auto& board : boards) {
+      gradient.Add(board, 1.0f);
+    }
+  }
+  auto gradientElapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - gradientStart).count();
+  Print("gradient      ", static_cast<double>(boards.size()) * gradientPasses, gradientElapsed, -1.0);
+  gradientStart = std::chrono::steady_clock::now();
+  for (int pass = 0; pass < gradientPasses; pass++) {
+    gradient.Add(boards.data(), gradients.data(), boards.size());
+  }
+  gradientElapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - gradientStart).count();
+  Print("gradient batch", static_cast<double>(boards.size()) * gradientPasses, gradientElapsed, -1.0);
+
+  double error = 0.0;
+  for (size_t i = 0; i < indices.size(); i++) {
+    error += std::abs(eval->Evaluate(indices[i]) - exact[i]);
+  }
+  std::cout << "mean abs error of int8: " << std::setprecision(2) << error / indices.size() / ScoreScale << " discs" << std::endl;
+
+  // the network from the accumulators, which take the place of the feature indices in the search
+  std::shared_ptr<Network> network = LoadNetwork();
+  std::vector<NetworkAccumulator> accumulators;
+  for (const Board& board : boards) {
+    accumulators.emplace_back(*network, board);
+  }
+  auto start = std::chrono::steady_clock::now();
+  for (int pass = 0; pass < passes; pass++) {
+    for (size_t i = 0; i < boards.size(); i++) {
+      sum += network->Evaluate(accumulators[i]);
+    }
+  }
+  auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  Print("network       ", static_cast<double>(boards.size()) * passes, elapsed, -1.0);
+
+  std::cout << "(checksum " << sum << ")" << std::endl;
+  return 0;
+}
+
+// Runs searchers on separate threads over one evaluator, and compares the evaluations
+// and the exact ending scores with the results of a single thread.
+int Stress(size_t count, int threadCount) {
+  std::shared_ptr<const Evaluator> eval = LoadEvaluator();
+
+  std::vector<Board> boards = GenerateBoards(count, 5);
+  std::vector<Score> evals;
+  std::vector<Board> endings;
+  std::vector<Board> midgames;
+  for (const Board& board : boards) {
+    evals.push_back(eval->Evaluate(board));
+    int empties = 64 - (board.GetBlackBoard() | board.GetWhiteBoard()).Count();
+    if (empties == 10 && endings.size() < 64) {
+      endings.push_back(board);
+    } else if (empties == 40 && midgames.size() < 64) {
+      midgames.push_back(board);
+    }
+  }
+
+  std::vector<Score> endingScores;
+  {
+    Searcher searcher(eval);
+    for (const Board& board : endings) {
+      endingScores.push_back(searcher.Search(board, 1, 64).score);
+    }
+  }
+
+  std::atomic<size_t> errors(0);
+  std::atomic<size_t> searches(0);
+  auto start = std::chrono::steady_clock::now();
+
+  std::vector<std::thread> threads;
+  for (int ti = 0; ti < threadCount; ti++) {
+    threads.emplace_back([&, ti]() {
+      Searcher searcher(eval);
+      for (size_t i = 0; i < boards.size(); i++) {
+        // each thread starts at a different board
+        size_t bi = (i + boards.size() * ti / threadCount) % boards.size();
+        if (eval->Evaluate(boards[bi]) != evals[bi]) {
+          errors++;
+        }
+
+        if (i % 64 == 0) {
+          size_t si = i / 64 + ti;
+          if (!endings.empty() && searcher.Search(endings[si % endings.size()], 1, 64).score != endingScores[si % endings.size()]) {
+            errors++;
+          }
+          if (!midgames.empty()) {
+            searcher.Search(midgames[si % midgames.size()], 4, 0);
+          }
+          searches += 2;
+        }
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  std::cout << "stress: " << threadCount << " threads, "
+            << boards.size() * threadCount << " evaluations, "
+            << searches.load() << " searches, "
+            << std::fixed << std::setprecision(3) << elapsed << " sec "
+            << (errors == 0 ? "OK" : "NG") << std::endl;
+  return errors == 0 ? 0 : 1;
+}
+
+// Plays games between the pattern evaluator and the network at a fixed time per move,
+// and prints the results and the nodes per move of the network.
+// Each opening is played with both colours, and the last empties are solved exactly by both sides.
+int Versus(size_t games, int millis) {
+  constexpr int OpeningMoves = 8;
+  constexpr int EndingDepth = 12;
+
+  std::shared_ptr<Evaluator> patternEval = LoadEvaluator();
+  std::shared_ptr<Evaluator> networkEval(new Evaluator);
+  networkEval->SetNetwork(LoadNetwork());
+  Searcher patternSearcher(patternEval);
+  Searcher networkSearcher(networkEval);
+
+  std::mt19937 rng(9);
+  int wins = 0;
+  int draws = 0;
+  int losses = 0;
+  int discs = 0;
+  uint64_t nodes[2] = {};
+  int moves[2] = {};
+  Board opening;
+  for (size_t game = 0; game < games; game++) {
+    if (game % 2 == 0) {
+      opening = Board::GetNormalInitBoard();
+      for (int ply = 0; ply < OpeningMoves && !opening.IsEnd(); ply++) {
+        if (opening.MustPass()) {
+          opening.Pass();
+        }
+        Bitboard legal = opening.GenerateMoves();
+        int n = static_cast<int>(rng() % legal.Count());
+        for (Square square : legal) {
+          if (n-- == 0) {
+            opening.DoMove(square);
+            break;
+          }
+        }
+      }
+    }
+    const DiskColor networkColor = game % 2 == 0 ? ColorBlack : ColorWhite;
+
+    Board board = opening;
+    while (!board.IsEnd()) {
+      if (board.MustPass()) {
+        board.Pass();
+        continue;
+      }
+      const int side = board.GetNextDisk() == networkColor ? 1 : 0;
+      Searcher& searcher = side == 1 ? networkSearcher : patternSearcher;
+      const int empties = 64 - (board.GetBlackBoard() | board.GetWhiteBoard()).Count();
+
+      // the stop flag is left set by the timer of the previous move
+      searcher.Reset();
+      SearchResult result;
+      if (empties <= EndingDepth) {
+        result = searcher.Search(board, 1, EndingDepth);
+      } else {
+        // the best move of the last finished iteration is played when the time is up
+        std::thread timer([&searcher, millis]() {
+          std::this_thread::sleep_for(std::chrono::milliseconds(millis));
+          searcher.Stop();
+        });
+        result = searcher.Search(board, 60, EndingDepth);
+        timer.join();
+        nodes[side] += searcher.GetStatistics().nodes;
+        moves[side]++;
+      }
+      board.DoMove(result.move);
+    }
+
+    int diff = board.GetBlackBoard().Count() - board.GetWhiteBoard().Count();
+    diff = networkColor == ColorBlack ? diff : -diff;
+    discs += diff;
+    wins += diff > 0 ? 1 : 0;
+    draws += diff == 0 ? 1 : 0;
+    losses += diff < 0 ? 1 : 0;
+  }
+
+  std::cout << "versus: " << games << " games, " << millis << " msec/move" << std::endl;
+  std::cout << "network: " << wins << " wins, " << draws << " draws, " << losses << " losses, "
+            << std::fixed << std::setprecision(2) << static_cast<double>(discs) / games << " discs/game" << std::endl;
+  std::cout << "nodes/move: pattern " << std::setprecision(0) << (moves[0] != 0 ? static_cast<double>(nodes[0]) / moves[0] : 0.0)
+            << ", network " << (moves[1] != 0 ? static_cast<double>(nodes[1]) / moves[1] : 0.0) << std::endl;
+  return 0;
+}
+
+// Measures the time to reach a fixed depth on midgame boards with 1, 2, 4, ... threads
+// up to maxThreads, and prints the speedup over a single thread.
+// Each thread count starts with an empty transposition table.
+int Smp(size_t count, int maxThreads) {
+  constexpr int Depth = 9;
+  constexpr int Empties = 36;
+
+  std::shared_ptr<const Evaluator> eval = LoadEvaluator();
+  std::vector<Board> boards;
+  for (const Board& board : GenerateBoards(count * 64, 10)) {
+    if (64 - (board.GetBlackBoard() | board.GetWhiteBoard()).Count() == Empties && boards.size() < count) {
+      boards.push_back(board);
+    }
+  }
+
+  std::vector<int> threadCounts;
+  for (int threads = 1; threads < maxThreads; threads *= 2) {
+    threadCounts.push_back(threads);
+  }
+  threadCounts.push_back(maxThreads);
+
+  // the speedup of the thread counts above the hardware threads only shows the overhead
+  const unsigned hardwareThreads = std::thread::hardware_concurrency();
+  std::cout << "smp: " << boards.size() << " boards, depth " << Depth << ", "
+            << hardwareThreads << " hardware threads" << std::endl;
+  double base = 0.0;
+  for (int threads : threadCounts) {
+    Searcher searcher(eval, nullptr);
+    searcher.SetThreadCount(threads);
+    uint64_t nodes = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (const Board& board : boards) {
+      searcher.Search(board, Depth, 0);
+      nodes += searcher.GetStatistics().nodes;
+    }
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (threads == 1) {
+      base = elapsed;
+    }
+    std::cout << std::setw(3) << threads << " threads: "
+              << std::fixed << std::setprecision(3) << elapsed << " sec, speedup "
+              << std::setprecision(2) << (elapsed > 0.0 ? base / elapsed : 0.0) << ", "
+              << std::setprecision(2) << (elapsed > 0.0 ? static_cast<double>(nodes) / elapsed * 1e-6 : 0.0) << " Mnodes/sec"
+              << (static_cast<unsigned>(threads) > hardwareThreads ? " (more threads than the hardware)" : "") << std::endl;
+  }
+  return 0;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  std::string mode = argc >= 2 ? argv[1] : "check";
+  size_t count = argc >= 3 ? std::strtoul(argv[2], nullptr, 10) : 100000;
+  int threadCount = argc >= 4 ? std::atoi(argv[3]) : 4;
+  if (count == 0 || threadCount < 1) {
+    std::cerr << "usage: evalbench [check|speed|stress|versus|smp] [boards|games] [threads|msec]" << std::endl;
+    return 1;
+  }
+
+  if (mode == "check") {
+    return Check(count);
+  } else if (mode == "speed") {
+    return Speed(count);
+  } else if (mode == "stress") {
+    return Stress(count, threadCount);
+  } else if (mode == "versus") {
+    // the count is the number of games, and the third argument is the time per move
+    return Versus(argc >= 3 ? count : 20, argc >= 4 ? threadCount : 100);
+  } else if (mode == "smp") {
+    // the third argument is the largest number of threads
+    return Smp(argc >= 3 ? count : 16, argc >= 4 ? threadCount : 32);
+  }
+
+  std::cerr << "usage: evalbench [check|speed|stress|versus|smp] [boards|games] [threads|msec]" << std::endl;
+  return 1;
+}
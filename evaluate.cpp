@@ -1,204 +1,831 @@
 #include "evaluate.h"
 #include "reversi.h"
+#include "bitop.h"
+#include "cpu.h"
+#include "mapped_file.h"
+#include "network.h"
+#include "aligned.h"
 #include <fstream>
 #include <sstream>
+#include <algorithm>
+#include <cstddef>
+#include <cstdlib>
 #include <cstdint>
+#include <cstdio>
 #include <cstring>
+#include <memory>
+#include <vector>
 
 namespace {
 
+// The signature of the old format, which is followed by the weights in the native byte order.
 const char Signature[] = {
    'b',  'e',  'l',  'u',  'g',  'a', 0x00, 0x00,
   0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
 };
 
+// The current format is the header, the weights in the order of FeatureParameters,
+// and zeros up to a multiple of ParamFileAlignment.
+// Version 2 is followed by the weights of GlobalParameters and zeros in the same way.
+// Version 3 has the weights and zeros of StageCount stages back to back, followed by
+// GlobalParameters if globalCount is not 0.
+// The weights start at an aligned offset, so the mapped file is used in place.
+struct ParamFileHeader {
+  char magic[8];
+  uint32_t byteOrder; // ParamFileByteOrder in the byte order of the writer
+  uint32_t version;
+  uint32_t headerSize; // the offset of the weights
+  uint32_t weightSize;
+  uint32_t weightCount;
+  uint32_t globalCount; // the number of the global weights, and 0 in version 1
+  uint32_t stageCount;  // the number of stages in version 3, and 0 in the older versions
+  uint32_t reserved[7];
+};
+
+static_assert(sizeof(ParamFileHeader) == 64, "the header must keep the weights aligned");
+
+const char ParamFileMagic[8] = { 'b', 'e', 'l', 'u', 'g', 'a', 'E', 'V' };
+constexpr uint32_t ParamFileByteOrder = 0x01020304;
+constexpr uint32_t ParamFileVersion = 1;
+constexpr uint32_t ParamFileGlobalVersion = 2;
+constexpr uint32_t ParamFileStageVersion = 3;
+constexpr uint32_t ParamFileAlignment = 64;
+constexpr uint32_t ParamFileWeightCount = sizeof(beluga::FeatureParameters<beluga::Score>) / sizeof(beluga::Score);
+
+// the size of the pattern weights and the zeros after them
+constexpr uint32_t ParamFilePaddedWeightSize = sizeof(beluga::FeatureParameters<beluga::Score>)
+  + ParamFileAlignment - sizeof(beluga::FeatureParameters<beluga::Score>) % ParamFileAlignment;
+
+static_assert(ParamFilePaddedWeightSize - sizeof(beluga::FeatureParameters<beluga::Score>) >= 2 * sizeof(beluga::Score),
+              "the padding must cover the over-read of the gather kernel");
+
+uint32_t SwapBytes(uint32_t x) {
+  return (x >> 24) | ((x >> 8) & 0xff00) | ((x << 8) & 0xff0000) | (x << 24);
+}
+
+uint16_t SwapBytes(uint16_t x) {
+  return static_cast<uint16_t>((x >> 8) | (x << 8));
+}
+
+// Converts the header to the native byte order, and returns an error message or nullptr.
+// The stageCount of the older versions is set to 1.
+const char* ParseHeader(ParamFileHeader& header, bool& swapped) {
+  if (memcmp(header.magic, ParamFileMagic, sizeof(ParamFileMagic)) != 0) {
+    return "ERROR: The evaluation parameter file has an invalid signature";
+  }
+
+  swapped = header.byteOrder != ParamFileByteOrder;
+  if (swapped) {
+    header.byteOrder = SwapBytes(header.byteOrder);
+    header.version = SwapBytes(header.version);
+    header.headerSize = SwapBytes(header.headerSize);
+    header.weightSize = SwapBytes(header.weightSize);
+    header.weightCount = SwapBytes(header.weightCount);
+    header.globalCount = SwapBytes(header.globalCount);
+    header.stageCount = SwapBytes(header.stageCount);
+    if (header.byteOrder != ParamFileByteOrder) {
+      return "ERROR: The evaluation parameter file has an unknown byte order";
+    }
+  }
+
+  if (header.version != ParamFileVersion
+   && header.version != ParamFileGlobalVersion
+   && header.version != ParamFileStageVersion) {
+    return "ERROR: The evaluation parameter file has an unsupported version";
+  }
+
+  bool validCounts = false;
+  if (header.version == ParamFileVersion) {
+    validCounts = header.globalCount == 0 && header.stageCount == 0;
+  } else if (header.version == ParamFileGlobalVersion) {
+    validCounts = header.globalCount == beluga::GlobalParameterCount && header.stageCount == 0;
+  } else {
+    validCounts = (header.globalCount == 0 || header.globalCount == beluga::GlobalParameterCount)
+               && header.stageCount == beluga::StageCount;
+  }
+  if (header.headerSize < sizeof(ParamFileHeader)
+   || header.headerSize % ParamFileAlignment != 0
+   || header.weightSize != sizeof(beluga::Score)
+   || header.weightCount != ParamFileWeightCount
+   || !validCounts) {
+    return "ERROR: The evaluation parameter file has an unexpected layout";
+  }
+
+  if (header.version != ParamFileStageVersion) {
+    header.stageCount = 1;
+  }
+
+  return nullptr;
+}
+
 } // namespace
 
 namespace beluga {
 
-template <int8_t s>
-inline int Horner(const Board& board) {
-  auto diskColor = board.Get(Square(s));
-  return static_cast<int>(diskColor);
-}
-
-template <int8_t s0, int8_t s1, int8_t ...ss>
-inline int Horner(const Board& board) {
-  auto diskColor = board.Get(Square(s0));
-  return static_cast<int>(diskColor) + Horner<s1, ss...>(board) * 3;
-}
-
-template <class T, bool eval>
-T ExtractFeature(const Board& board, FeatureParameters<T>& vector, T gradient = 0) {
-  T score = 0;
-
-#define EXTRACT(elem) if (eval) { score += (elem); } else { (elem) += gradient; }
-
-  EXTRACT((vector.Edge[Horner<011, 000, 001, 002, 003, 004, 005, 006, 007, 016>(board)]));
-  EXTRACT((vector.Edge[Horner<061, 070, 071, 072, 073, 074, 075, 076, 077, 066>(board)]));
-  EXTRACT((vector.Edge[Horner<011, 000, 010, 020, 030, 040, 050, 060, 070, 061>(board)]));
-  EXTRACT((vector.Edge[Horner<016, 007, 017, 027, 037, 047, 057, 067, 077, 066>(board)]));
-
-  EXTRACT((vector.Hor2[Horner<010, 011, 012, 013, 014, 015, 016, 017>(board)]));
-  EXTRACT((vector.Hor2[Horner<060, 061, 062, 063, 064, 065, 066, 067>(board)]));
-  EXTRACT((vector.Hor2[Horner<001, 011, 021, 031, 041, 051, 061, 071>(board)]));
-  EXTRACT((vector.Hor2[Horner<006, 016, 026, 036, 046, 056, 066, 076>(board)]));
-
-  EXTRACT((vector.Hor3[Horner<020, 021, 022, 023, 024, 025, 026, 027>(board)]));
-  EXTRACT((vector.Hor3[Horner<050, 051, 052, 053, 054, 055, 056, 057>(board)]));
-  EXTRACT((vector.Hor3[Horner<002, 012, 022, 032, 042, 052, 062, 072>(board)]));
-  EXTRACT((vector.Hor3[Horner<005, 015, 025, 035, 045, 055, 065, 075>(board)]));
-
-  EXTRACT((vector.Hor4[Horner<030, 031, 032, 033, 034, 035, 036, 037>(board)]));
-  EXTRACT((vector.Hor4[Horner<040, 041, 042, 043, 044, 045, 046, 047>(board)]));
-  EXTRACT((vector.Hor4[Horner<003, 013, 023, 033, 043, 053, 063, 073>(board)]));
-  EXTRACT((vector.Hor4[Horner<004, 014, 024, 034, 044, 054, 064, 074>(board)]));
-
-  EXTRACT((vector.Diag8[Horner<000, 011, 022, 033, 044, 055, 066, 077>(board)]));
-  EXTRACT((vector.Diag8[Horner<070, 061, 052, 043, 034, 025, 016, 007>(board)]));
-
-  EXTRACT((vector.Diag7[Horner<001, 012, 023, 034, 045, 056, 067>(board)]));
-  EXTRACT((vector.Diag7[Horner<010, 021, 032, 043, 054, 065, 076>(board)]));
-  EXTRACT((vector.Diag7[Horner<071, 062, 053, 044, 035, 026, 017>(board)]));
-  EXTRACT((vector.Diag7[Horner<060, 051, 042, 033, 024, 015, 006>(board)]));
-
-  EXTRACT((vector.Diag6[Horner<002, 013, 024, 035, 046, 057>(board)]));
-  EXTRACT((vector.Diag6[Horner<020, 031, 042, 053, 064, 075>(board)]));
-  EXTRACT((vector.Diag6[Horner<072, 063, 054, 045, 036, 027>(board)]));
-  EXTRACT((vector.Diag6[Horner<050, 041, 032, 023, 014, 005>(board)]));
-
-  EXTRACT((vector.Diag5[Horner<003, 014, 025, 036, 047>(board)]));
-  EXTRACT((vector.Diag5[Horner<030, 041, 052, 063, 074>(board)]));
-  EXTRACT((vector.Diag5[Horner<073, 064, 055, 046, 037>(board)]));
-  EXTRACT((vector.Diag5[Horner<040, 031, 022, 013, 004>(board)]));
-
-  EXTRACT((vector.Diag4[Horner<004, 015, 026, 037>(board)]));
-  EXTRACT((vector.Diag4[Horner<040, 051, 062, 073>(board)]));
-  EXTRACT((vector.Diag4[Horner<074, 065, 056, 047>(board)]));
-  EXTRACT((vector.Diag4[Horner<030, 021, 012, 003>(board)]));
-
-  EXTRACT((vector.Corner3x3[Horner<000, 001, 002,
-                                   010, 011, 012,
-                                   020, 021, 022>(board)]));
-  EXTRACT((vector.Corner3x3[Horner<007, 006, 005,
-                                   017, 016, 015,
-                                   027, 026, 025>(board)]));
-  EXTRACT((vector.Corner3x3[Horner<070, 071, 072,
-                                   060, 061, 062,
-                                   050, 051, 052>(board)]));
-  EXTRACT((vector.Corner3x3[Horner<077, 076, 075,
-                                   067, 066, 065,
-                                   057, 056, 055>(board)]));
-
-  EXTRACT((vector.Corner5x2[Horner<000, 001, 002, 003, 004,
-                                   010, 011, 012, 013, 014>(board)]));
-  EXTRACT((vector.Corner5x2[Horner<007, 006, 005, 004, 003,
-                                   017, 016, 015, 014, 013>(board)]));
-  EXTRACT((vector.Corner5x2[Horner<070, 071, 072, 073, 074,
-                                   060, 061, 062, 063, 064>(board)]));
-  EXTRACT((vector.Corner5x2[Horner<077, 076, 075, 074, 073,
-                                   067, 066, 065, 064, 063>(board)]));
-  EXTRACT((vector.Corner5x2[Horner<000, 010, 020, 030, 040,
-                                   001, 011, 021, 031, 041>(board)]));
-  EXTRACT((vector.Corner5x2[Horner<070, 060, 050, 040, 030,
-                                   071, 061, 051, 041, 031>(board)]));
-  EXTRACT((vector.Corner5x2[Horner<007, 017, 027, 037, 047,
-                                   006, 016, 026, 036, 046>(board)]));
-  EXTRACT((vector.Corner5x2[Horner<077, 067, 057, 047, 037,
-                                   076, 066, 056, 046, 036>(board)]));
-
-#undef EXTRACT
+#if BELUGA_AVX2
+namespace avx2 {
 
-  return score;
+// defined in evaluate_avx2.cpp
+Score Evaluate(const Score* weights, const int32_t* indices);
+Score EvaluateQuantized(const int8_t* weights, const int32_t* scales, const int32_t* indices);
+void ExtractIndices(const uint64_t* black, const uint64_t* white, size_t count, const FeatureMagicTable& table,
+                    int32_t (*indices)[PaddedFeatureCount]);
+
+} // namespace avx2
+#endif
+
+// The index of a feature read square by square, which is fully specialized
+// from PatternDefinitions. It is the reference for the table based extraction.
+template <int feature, int digit = 0, bool end = digit == GetFeatureLength(feature)>
+struct ReferenceExtractor {
+  static int GetIndex(const Board& board) {
+    auto diskColor = board.Get(Square(static_cast<Square::RawType>(GetFeatureSquare(feature, digit))));
+    return static_cast<int>(diskColor) + ReferenceExtractor<feature, digit + 1>::GetIndex(board) * 3;
+  }
+};
+
+template <int feature, int digit>
+struct ReferenceExtractor<feature, digit, true> {
+  static int GetIndex(const Board&) {
+    return 0;
+  }
+};
+
+// Adds 1 to the weight of each feature.
+template <int feature = 0>
+struct ReferenceCounter {
+  static void Add(const Board& board, uint8_t* counts) {
+    counts[GetPatternOffset(GetFeaturePattern(feature)) + ReferenceExtractor<feature>::GetIndex(board)]++;
+    ReferenceCounter<feature + 1>::Add(board, counts);
+  }
+};
+
+template <>
+struct ReferenceCounter<FeatureCount> {
+  static void Add(const Board&, uint8_t*) {
+  }
+};
+
+struct FeatureDelta {
+  int feature;
+  int power;
+};
+
+struct SquareFeatures {
+  int count;
+  FeatureDelta deltas[MaxSquareFeatureCount];
+};
+
+// [square] => the features including the square and the power of 3 of the square
+struct SquareFeatureTable {
+  SquareFeatures squares[64];
+
+  SquareFeatureTable() {
+    for (int sq = 0; sq < 64; sq++) {
+      squares[sq].count = 0;
+    }
+
+    for (int fi = 0; fi < FeatureCount; fi++) {
+      int power = 1;
+      for (int i = 0; i < GetFeatureLength(fi); i++) {
+        auto& sf = squares[GetFeatureSquare(fi, i)];
+        sf.deltas[sf.count++] = { fi, power };
+        power *= 3;
+      }
+    }
+  }
+};
+
+const SquareFeatureTable squareFeatureTable;
+
+// The magic multipliers which gather the squares of each feature into the
+// top bits without collision. They are used when pext is not available.
+// The features without a valid magic get one from FindMagic at startup,
+// which prints it to be added here.
+const uint64_t FeatureMagics[] = {
+  0x4500224600040001llu, 0x0100102014300a41llu, 0x4810048000400104llu, 0x0080200804400603llu,
+  0x8003001210902000llu, 0x0008040200201010llu, 0x40040102100822a0llu, 0x0880220024102841llu,
+  0x1210780800010a02llu, 0x0000050402010100llu, 0x8220081004004281llu, 0x0c00402008918201llu,
+  0x1208004100262088llu, 0x0442000010100300llu, 0x0700804200300408llu, 0x0802003680240141llu,
+  0x5002060406111101llu, 0x80c0104801100806llu,
+  0x0108010405220020llu, 0x0508101188004186llu, 0x080880482202200cllu, 0x0104020480880800llu,
+  0x8630010101001800llu, 0x040080080811104allu, 0x00800080844100a0llu, 0x4100880440061040llu,
+  0x091c009202c26420llu, 0xa84000c104041012llu, 0x10062001018200a2llu, 0x1110100461004001llu,
+  0x0200920889040210llu, 0x2542688880084808llu, 0x00000000b82a0114llu, 0x1010103420000000llu,
+  0x6401200004121001llu, 0x0100201c40041840llu, 0x0001200400082001llu, 0x000004120c002009llu,
+  0x8908002040008001llu, 0x8d00080000052214llu, 0x2080343800020108llu, 0x4000000000222121llu,
+  0x9002400104002021llu, 0x0003011005094004llu, 0x0230400100040000llu, 0x02c0108010144001llu,
+};
+
+constexpr int FeatureMagicCount = sizeof(FeatureMagics) / sizeof(FeatureMagics[0]);
+
+// used is a buffer of 1 << length entries, which is cleared here.
+bool IsCollisionFree(uint64_t mask, uint64_t magic, int length, std::vector<bool>& used) {
+  used.assign(size_t(1) << length, false);
+  uint64_t bits = 0;
+  do {
+    const size_t index = static_cast<size_t>((bits * magic) >> (64 - length));
+    if (used[index]) {
+      return false;
+    }
+    used[index] = true;
+    bits = (bits - mask) & mask;
+  } while (bits != 0);
+  return true;
+}
+
+// Searches sparse random multipliers, or returns 0 if none is found.
+uint64_t FindMagic(uint64_t mask, int length) {
+  uint64_t state = 0x9e3779b97f4a7c15llu ^ mask;
+  auto next = [&state]() {
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return state;
+  };
+  std::vector<bool> used;
+  for (int i = 0; i < 10000000; i++) {
+    const uint64_t magic = next() & next() & next();
+    if (IsCollisionFree(mask, magic, length, used)) {
+      return magic;
+    }
+  }
+  return 0;
 }
 
-template <class T, class F>
-void Symmetrize(FeatureParameters<T>& vector, F&& func) {
-#define BEGIN(var) for (int var = 0; var < 3; var++) {
-#define END }
+// Extracts the feature indices from the discs with pext or a magic multiplier,
+// and converts the binary index to the ternary index with a table.
+struct FeatureExtractor {
+  uint64_t mask;
+  uint64_t magic; // 0 if no magic is found
+  int shift;
+  int offset;
+  const uint16_t* ternary;
+
+  int GetBinaryIndex(uint64_t bits) const {
+#if BELUGA_BMI2
+    return static_cast<int>(ParallelExtract(bits, mask));
+#else
+    return magic != 0
+         ? static_cast<int>(((bits & mask) * magic) >> shift)
+         : static_cast<int>(ParallelExtract(bits, mask));
+#endif
+  }
+
+  int GetIndex(uint64_t black, uint64_t white) const {
+    return offset + ternary[GetBinaryIndex(black)] + ternary[GetBinaryIndex(white)] * 2;
+  }
+};
+
+struct FeatureExtractionTable {
+  FeatureExtractor features[FeatureCount];
+  std::vector<uint16_t> ternary;
 
-  BEGIN(c0) BEGIN(c1) BEGIN(c2) BEGIN(c3) BEGIN(c4) BEGIN(c5) BEGIN(c6) BEGIN(c7) BEGIN(c8) BEGIN(c9)
-    int i0 = ((((((((c0 * 3 + c1) * 3 + c2) * 3 + c3) * 3 + c4) * 3 + c5) * 3 + c6) * 3 + c7) * 3 + c8) * 3 + c9;
-    int i1 = ((((((((c9 * 3 + c8) * 3 + c7) * 3 + c6) * 3 + c5) * 3 + c4) * 3 + c3) * 3 + c2) * 3 + c1) * 3 + c0;
-    if (i0 < i1) {
-      vector.Edge[i0] = vector.Edge[i1] = func(vector.Edge[i0], vector.Edge[i1]);
+  // the same magics for the batch extraction, which is valid if hasAllMagics
+  FeatureMagicTable magicTable;
+  bool hasAllMagics;
+
+  FeatureExtractionTable() {
+    size_t size = 0;
+    for (int fi = 0; fi < FeatureCount; fi++) {
+      size += size_t(1) << GetFeatureLength(fi);
     }
-  END END END END END END END END END END
+    ternary.resize(size + 1);
+
+    size_t base = 0;
+    for (int fi = 0; fi < FeatureCount; fi++) {
+      const int length = GetFeatureLength(fi);
+      auto& fe = features[fi];
+      fe.mask = 0;
+      for (int i = 0; i < length; i++) {
+        fe.mask |= 1llu << GetFeatureSquare(fi, i);
+      }
+      fe.magic = fi < FeatureMagicCount ? FeatureMagics[fi] : 0;
+#if !BELUGA_BMI2
+      std::vector<bool> used;
+      if (!IsCollisionFree(fe.mask, fe.magic, length, used)) {
+        fe.magic = FindMagic(fe.mask, length);
+        if (fe.magic != 0) {
+          fprintf(stderr, "WARNING: Add 0x%016llxllu to FeatureMagics for the feature %d\n",
+                  static_cast<unsigned long long>(fe.magic), fi);
+        } else {
+          fprintf(stderr, "WARNING: No magic is found for the feature %d, which is extracted bit by bit\n", fi);
+        }
+      }
+#endif
+      fe.shift = 64 - length;
+      fe.offset = GetPatternOffset(GetFeaturePattern(fi));
+      fe.ternary = &ternary[base];
+
+      // enumerate all subsets of the mask
+      uint64_t bits = 0;
+      do {
+        int index = 0;
+        for (int i = length - 1; i >= 0; i--) {
+          index = index * 3 + ((bits >> GetFeatureSquare(fi, i)) & 1);
+        }
+        ternary[base + fe.GetBinaryIndex(bits)] = static_cast<uint16_t>(index);
+        bits = (bits - fe.mask) & fe.mask;
+      } while (bits != 0);
 
-  BEGIN(c0) BEGIN(c1) BEGIN(c2) BEGIN(c3) BEGIN(c4) BEGIN(c5) BEGIN(c6) BEGIN(c7)
-    int i0 = ((((((c0 * 3 + c1) * 3 + c2) * 3 + c3) * 3 + c4) * 3 + c5) * 3 + c6) * 3 + c7;
-    int i1 = ((((((c7 * 3 + c6) * 3 + c5) * 3 + c4) * 3 + c3) * 3 + c2) * 3 + c1) * 3 + c0;
-    if (i0 < i1) {
-      vector.Hor2[i0] = vector.Hor2[i1] = func(vector.Hor2[i0], vector.Hor2[i1]);
-      vector.Hor3[i0] = vector.Hor3[i1] = func(vector.Hor3[i0], vector.Hor3[i1]);
-      vector.Hor4[i0] = vector.Hor4[i1] = func(vector.Hor4[i0], vector.Hor4[i1]);
+      base += size_t(1) << length;
     }
-  END END END END END END END END
 
-  BEGIN(c0) BEGIN(c1) BEGIN(c2) BEGIN(c3) BEGIN(c4) BEGIN(c5) BEGIN(c6) BEGIN(c7)
-    int i0 = ((((((c0 * 3 + c1) * 3 + c2) * 3 + c3) * 3 + c4) * 3 + c5) * 3 + c6) * 3 + c7;
-    int i1 = ((((((c7 * 3 + c6) * 3 + c5) * 3 + c4) * 3 + c3) * 3 + c2) * 3 + c1) * 3 + c0;
-    if (i0 < i1) {
-      vector.Diag8[i0] = vector.Diag8[i1] = func(vector.Diag8[i0], vector.Diag8[i1]);
+    hasAllMagics = true;
+    for (int fi = 0; fi < FeatureCount; fi++) {
+      const auto& fe = features[fi];
+      magicTable.masks[fi] = fe.mask;
+      magicTable.magics[fi] = fe.magic;
+      magicTable.shifts[fi] = fe.shift;
+      magicTable.offsets[fi] = fe.offset;
+      magicTable.ternaryBases[fi] = static_cast<int32_t>(fe.ternary - ternary.data());
+      hasAllMagics = hasAllMagics && fe.magic != 0;
     }
-  END END END END END END END END
+    magicTable.ternary = ternary.data();
+  }
+};
 
-  BEGIN(c0) BEGIN(c1) BEGIN(c2) BEGIN(c3) BEGIN(c4) BEGIN(c5) BEGIN(c6)
-    int i0 = (((((c0 * 3 + c1) * 3 + c2) * 3 + c3) * 3 + c4) * 3 + c5) * 3 + c6;
-    int i1 = (((((c6 * 3 + c5) * 3 + c4) * 3 + c3) * 3 + c2) * 3 + c1) * 3 + c0;
-    if (i0 < i1) {
-      vector.Diag7[i0] = vector.Diag7[i1] = func(vector.Diag7[i0], vector.Diag7[i1]);
+const FeatureExtractionTable featureExtractionTable;
+
+// The boards are processed in batches of this size, whose indices fit in L1.
+// It is a multiple of the 4 boards of the AVX2 extraction.
+constexpr size_t BoardBatchSize = 32;
+
+// How many boards ahead the weights are prefetched.
+constexpr size_t PrefetchDistance = 4;
+
+void ExtractIndicesPortable(const uint64_t* black, const uint64_t* white, size_t count, const FeatureMagicTable&,
+                            int32_t (*indices)[PaddedFeatureCount]) {
+  for (int fi = 0; fi < FeatureCount; fi++) {
+    const FeatureExtractor& fe = featureExtractionTable.features[fi];
+    for (size_t bi = 0; bi < count; bi++) {
+      indices[bi][fi] = fe.GetIndex(black[bi], white[bi]);
     }
-  END END END END END END END
+  }
+}
+
+using ExtractIndicesFunc = void (*)(const uint64_t* black, const uint64_t* white, size_t count,
+                                    const FeatureMagicTable& table, int32_t (*indices)[PaddedFeatureCount]);
+
+// replaced by the AVX2 kernel in KernelSelector
+ExtractIndicesFunc ExtractIndicesKernel = ExtractIndicesPortable;
+
+// The indices of a batch of boards, extracted feature by feature over the discs in SoA,
+// so the same mask and magic are applied to 4 boards at once by the AVX2 kernel.
+struct FeatureIndicesBatch {
+  alignas(32) uint64_t black[BoardBatchSize];
+  alignas(32) uint64_t white[BoardBatchSize];
+  alignas(32) int32_t indices[BoardBatchSize][PaddedFeatureCount];
+  int discCounts[BoardBatchSize];
+
+  void Extract(const Board* boards, size_t count) {
+    for (size_t bi = 0; bi < count; bi++) {
+      black[bi] = boards[bi].GetBlackBoard().GetRaw();
+      white[bi] = boards[bi].GetWhiteBoard().GetRaw();
+      discCounts[bi] = PopCount(black[bi] | white[bi]);
+    }
+    ExtractIndicesKernel(black, white, count, featureExtractionTable.magicTable, indices);
+    for (size_t bi = 0; bi < count; bi++) {
+      for (int fi = FeatureCount; fi < PaddedFeatureCount; fi++) {
+        indices[bi][fi] = 0;
+      }
+    }
+  }
 
-  BEGIN(c0) BEGIN(c1) BEGIN(c2) BEGIN(c3) BEGIN(c4) BEGIN(c5)
-    int i0 = ((((c0 * 3 + c1) * 3 + c2) * 3 + c3) * 3 + c4) * 3 + c5;
-    int i1 = ((((c5 * 3 + c4) * 3 + c3) * 3 + c2) * 3 + c1) * 3 + c0;
-    if (i0 < i1) {
-      vector.Diag6[i0] = vector.Diag6[i1] = func(vector.Diag6[i0], vector.Diag6[i1]);
+  template <class T>
+  void Prefetch(const T* table, size_t bi) const {
+    for (int fi = 0; fi < FeatureCount; fi++) {
+      beluga::Prefetch(&table[indices[bi][fi]]);
     }
-  END END END END END END
+  }
+};
+
+// The batch of the calling thread, which is allocated on the first use and reused.
+FeatureIndicesBatch& GetThreadBatch() {
+  static thread_local AlignedPtr<FeatureIndicesBatch> batch = MakeAligned<FeatureIndicesBatch>();
+  return *batch;
+}
+
+// Sums the weights of each board of the batch with the kernel,
+// while the weights of the board PrefetchDistance ahead are fetched.
+// weights(bi) returns the weights of the stage of the board bi.
+template <class Weights, class Kernel>
+void EvaluateBatch(const FeatureIndicesBatch& batch, size_t count, Weights weights, Score* scores, Kernel kernel) {
+  for (size_t bi = 0; bi < std::min(PrefetchDistance, count); bi++) {
+    batch.Prefetch(weights(bi), bi);
+  }
+  for (size_t bi = 0; bi < count; bi++) {
+    if (bi + PrefetchDistance < count) {
+      batch.Prefetch(weights(bi + PrefetchDistance), bi + PrefetchDistance);
+    }
+    scores[bi] = kernel(weights(bi), batch.indices[bi], bi);
+  }
+}
+
+std::shared_ptr<QuantizedParameters> QuantizeParameters(const Score* weights) {
+  std::shared_ptr<QuantizedParameters> quantized(MakeAligned<QuantizedParameters>());
+  int8_t* qweights = reinterpret_cast<int8_t*>(&quantized->weights);
+
+  int32_t tableScales[PatternCount];
+  for (int pi = 0; pi < PatternCount; pi++) {
+    const int begin = GetPatternOffset(pi);
+    const int end = begin + GetPatternSize(pi);
+    int maxAbs = 0;
+    for (int i = begin; i < end; i++) {
+      maxAbs = std::max(maxAbs, std::abs(static_cast<int>(weights[i])));
+    }
+
+    // the smallest scale which maps all weights into [-127, 127]
+    const int scale = std::max(1, (maxAbs + 126) / 127);
+    for (int i = begin; i < end; i++) {
+      const int w = weights[i];
+      qweights[i] = static_cast<int8_t>(w >= 0 ? (w + scale / 2) / scale : -((-w + scale / 2) / scale));
+    }
+    tableScales[pi] = scale;
+  }
+
+  for (int fi = 0; fi < PaddedFeatureCount; fi++) {
+    quantized->scales[fi] = fi < FeatureCount ? tableScales[GetFeaturePattern(fi)] : 0;
+  }
+
+  return quantized;
+}
+
+constexpr int ParameterCount = sizeof(FeatureParameters<Score>) / sizeof(Score);
+
+// [index of FeatureParameters] => the slot of its equivalence class under the symmetry, and the sign
+// The symmetries of a pattern are the symmetries of the board which map its squares onto themselves,
+// such as the mirror images of a line, and the exchange of the colours, which negates the weight.
+// The weight is the slot times the sign, and the sign is 0 for the indices which are exchanged
+// into themselves, such as the empty line, because their weights are 0.
+struct SymmetryRemapTable {
+  std::vector<uint32_t> remap;
+  std::vector<int8_t> signs;
+  int canonicalCount;
 
-  BEGIN(c0) BEGIN(c1) BEGIN(c2) BEGIN(c3) BEGIN(c4)
-    int i0 = (((c0 * 3 + c1) * 3 + c2) * 3 + c3) * 3 + c4;
-    int i1 = (((c4 * 3 + c3) * 3 + c2) * 3 + c1) * 3 + c0;
-    if (i0 < i1) {
-      vector.Diag5[i0] = vector.Diag5[i1] = func(vector.Diag5[i0], vector.Diag5[i1]);
+  SymmetryRemapTable() : remap(ParameterCount), signs(ParameterCount) {
+    uint32_t slot = 0;
+    for (int pi = 0; pi < PatternCount; pi++) {
+      const auto& def = PatternDefinitions[pi];
+
+      // perms[k][d] is the digit which the digit d is moved to
+      std::vector<std::vector<int>> perms;
+      for (int symmetry = 1; symmetry < SymmetryCount; symmetry++) {
+        std::vector<int> perm(def.length, -1);
+        bool identity = true;
+        for (int d = 0; d < def.length; d++) {
+          const int square = TransformSquare(def.squares[d], symmetry);
+          for (int e = 0; e < def.length; e++) {
+            if (def.squares[e] == square) {
+              perm[d] = e;
+            }
+          }
+          identity = identity && perm[d] == d;
+        }
+        if (!identity && std::find(perm.begin(), perm.end(), -1) == perm.end()) {
+          perms.push_back(perm);
+        }
+      }
+
+      const int offset = GetPatternOffset(pi);
+      for (int i = 0; i < GetPatternSize(pi); i++) {
+        int digits[MaxPatternLength];
+        for (int d = 0, x = i; d < def.length; d++, x /= 3) {
+          digits[d] = x % 3;
+        }
+        // the images of the index, and those with the colours exchanged
+        int exchanged = 0;
+        for (int d = 0; d < def.length; d++) {
+          exchanged += (digits[d] == 0 ? 0 : 3 - digits[d]) * Pow3(d);
+        }
+        int canonical = i;
+        int exchangedCanonical = exchanged;
+        bool selfExchanged = exchanged == i;
+        for (const auto& perm : perms) {
+          int mirrored = 0;
+          int exchangedMirrored = 0;
+          for (int d = 0; d < def.length; d++) {
+            mirrored += digits[d] * Pow3(perm[d]);
+            exchangedMirrored += (digits[d] == 0 ? 0 : 3 - digits[d]) * Pow3(perm[d]);
+          }
+          canonical = std::min(canonical, mirrored);
+          exchangedCanonical = std::min(exchangedCanonical, exchangedMirrored);
+          selfExchanged = selfExchanged || exchangedMirrored == i;
+        }
+
+        // the smallest index of the class gets a new slot first
+        signs[offset + i] = selfExchanged ? 0 : canonical < exchangedCanonical ? 1 : -1;
+        canonical = std::min(canonical, exchangedCanonical);
+        if (canonical < i) {
+          remap[offset + i] = remap[offset + canonical];
+        } else {
+          remap[offset + i] = slot++;
+        }
+      }
     }
-  END END END END END
+    canonicalCount = static_cast<int>(slot);
+  }
+};
+
+const SymmetryRemapTable symmetryRemapTable;
+
+// Replaces the weights of each equivalence class with their mean times the signs,
+// because Evaluator::Update moves all weights of a class by the same step times the signs.
+void SymmetrizeWeights(Score* weights) {
+  std::vector<int32_t> sums(symmetryRemapTable.canonicalCount, 0);
+  std::vector<int32_t> counts(symmetryRemapTable.canonicalCount, 0);
+  for (int i = 0; i < ParameterCount; i++) {
+    sums[symmetryRemapTable.remap[i]] += symmetryRemapTable.signs[i] * weights[i];
+    counts[symmetryRemapTable.remap[i]]++;
+  }
+  for (int i = 0; i < ParameterCount; i++) {
+    const uint32_t slot = symmetryRemapTable.remap[i];
+    weights[i] = static_cast<Score>(symmetryRemapTable.signs[i] * (sums[slot] / counts[slot]));
+  }
+}
 
-  BEGIN(c0) BEGIN(c1) BEGIN(c2) BEGIN(c3)
-    int i0 = ((c0 * 3 + c1) * 3 + c2) * 3 + c3;
-    int i1 = ((c3 * 3 + c2) * 3 + c1) * 3 + c0;
-    if (i0 < i1) {
-      vector.Diag4[i0] = vector.Diag4[i1] = func(vector.Diag4[i0], vector.Diag4[i1]);
+bool IsSymmetric(const Score* weights) {
+  std::vector<int> first(symmetryRemapTable.canonicalCount, -1);
+  for (int i = 0; i < ParameterCount; i++) {
+    const int sign = symmetryRemapTable.signs[i];
+    int& f = first[symmetryRemapTable.remap[i]];
+    if (sign == 0) {
+      if (weights[i] != 0) {
+        return false;
+      }
+    } else if (f < 0) {
+      f = i;
+    } else if (symmetryRemapTable.signs[f] * weights[f] != sign * weights[i]) {
+      return false;
     }
-  END END END END
+  }
+  return true;
+}
 
-  BEGIN(c0) BEGIN(c1) BEGIN(c2) BEGIN(c3) BEGIN(c4) BEGIN(c5) BEGIN(c6) BEGIN(c7) BEGIN(c8)
-    int i0 = (((((((c0 * 3 + c1) * 3 + c2) * 3 + c3) * 3 + c4) * 3 + c5) * 3 + c6) * 3 + c7) * 3 + c8;
-    int i1 = (((((((c0 * 3 + c3) * 3 + c6) * 3 + c1) * 3 + c4) * 3 + c7) * 3 + c2) * 3 + c5) * 3 + c8;
-    if (i0 < i1) {
-      vector.Corner3x3[i0] = vector.Corner3x3[i1] = func(vector.Corner3x3[i0], vector.Corner3x3[i1]);
+#define GLOBAL_OFFSET(table) static_cast<int>(offsetof(GlobalParameters, table) / sizeof(Score))
+
+constexpr int GlobalFeatureCount = 5;
+
+const uint64_t QuadrantMasks[4] = {
+  0x000000000f0f0f0fllu, 0x00000000f0f0f0f0llu, 0x0f0f0f0f00000000llu, 0xf0f0f0f000000000llu,
+};
+
+// The offsets in GlobalParameters of the global features, which take only the move generation
+// and popcounts on the bitboards.
+struct GlobalFeatureIndices {
+  int indices[GlobalFeatureCount];
+
+  GlobalFeatureIndices(const Bitboard& player, const Bitboard& opponent) {
+    const Bitboard empty = ~(player | opponent);
+    int oddQuadrants = 0;
+    for (uint64_t quadrant : QuadrantMasks) {
+      oddQuadrants += (empty & Bitboard(quadrant)).Count() & 1;
     }
-  END END END END END END END END END
 
-#undef BEGIN
-#undef END
+    indices[0] = GLOBAL_OFFSET(PlayerMobility) + Board::GenerateMoves(player, opponent).Count();
+    indices[1] = GLOBAL_OFFSET(OpponentMobility) + Board::GenerateMoves(opponent, player).Count();
+    indices[2] = GLOBAL_OFFSET(PlayerFrontier) + Board::GetFrontierDisks(player, opponent).Count();
+    indices[3] = GLOBAL_OFFSET(OpponentFrontier) + Board::GetFrontierDisks(opponent, player).Count();
+    indices[4] = GLOBAL_OFFSET(Parity) + empty.Count() % 2 * 5 + oddQuadrants;
+  }
+};
+
+#undef GLOBAL_OFFSET
+
+// Adds the gradient relative to black to the slots of GlobalParameters,
+// which are relative to the side to move.
+void AddGlobalGradient(float* slots, const Board& board, float gradient) {
+  const PlayerBoard playerBoard(board);
+  const GlobalFeatureIndices gi(playerBoard.GetPlayerBoard(), playerBoard.GetOpponentBoard());
+  const float g = board.GetNextDisk() == ColorBlack ? gradient : -gradient;
+  for (int i = 0; i < GlobalFeatureCount; i++) {
+    slots[gi.indices[i]] += g;
+  }
+}
+
+Score EvaluatePortable(const Score* weights, const int32_t* indices) {
+  Score score = 0;
+  for (int fi = 0; fi < FeatureCount; fi++) {
+    score += weights[indices[fi]];
+  }
+  return score;
+}
+
+Score EvaluateQuantizedPortable(const int8_t* weights, const int32_t* scales, const int32_t* indices) {
+  int score = 0;
+  for (int fi = 0; fi < FeatureCount; fi++) {
+    score += weights[indices[fi]] * scales[fi];
+  }
+  return static_cast<Score>(score);
+}
+
+using EvaluateFunc = Score (*)(const Score* weights, const int32_t* indices);
+using EvaluateQuantizedFunc = Score (*)(const int8_t* weights, const int32_t* scales, const int32_t* indices);
+
+// The portable kernels are set before any dynamic initialization,
+// and replaced by the best ones for the running CPU.
+EvaluateFunc EvaluateKernel = EvaluatePortable;
+EvaluateQuantizedFunc EvaluateQuantizedKernel = EvaluateQuantizedPortable;
+
+struct KernelSelector {
+  KernelSelector() {
+#if BELUGA_AVX2
+    if (GetCpuFeatures().avx2) {
+      EvaluateKernel = avx2::Evaluate;
+      EvaluateQuantizedKernel = avx2::EvaluateQuantized;
+#if !BELUGA_BMI2
+      // pext is as fast as the AVX2 extraction
+      if (featureExtractionTable.hasAllMagics) {
+        ExtractIndicesKernel = avx2::ExtractIndices;
+      }
+#endif
+    }
+#endif
+  }
+} kernelSelector;
+
+Gradient::Gradient(int stageCount)
+  : slots_(symmetryRemapTable.canonicalCount * stageCount + GlobalParameterCount, 0.0f), stageCount_(stageCount) {
 }
 
 void Gradient::Add(const Board& board, float gradient) {
-  ExtractFeature<float, false>(board, *this, gradient);
+  // the indices are relative to the side to move, and the gradient to black
+  FeatureIndices indices(board);
+  const int stage = stageCount_ == 1 ? 0 : GetStage(indices.GetDiscCount());
+  const float g = board.GetNextDisk() == ColorBlack ? gradient : -gradient;
+  float* slots = &slots_[symmetryRemapTable.canonicalCount * stage];
+  for (int fi = 0; fi < FeatureCount; fi++) {
+    const int32_t index = indices.Get()[fi];
+    slots[symmetryRemapTable.remap[index]] += symmetryRemapTable.signs[index] * g;
+  }
+  AddGlobalGradient(&slots_[symmetryRemapTable.canonicalCount * stageCount_], board, gradient);
 }
 
-void Gradient::Symmetrize() {
-  beluga::Symmetrize(*this, [](float a, float b) {
-      return a + b;
-  });
+void Gradient::Add(const Board* boards, const float* gradients, size_t count) {
+  FeatureIndicesBatch* batch = &GetThreadBatch();
+  const uint32_t* remap = symmetryRemapTable.remap.data();
+  const int8_t* signs = symmetryRemapTable.signs.data();
+  float* slots = slots_.data();
+  for (size_t begin = 0; begin < count; begin += BoardBatchSize) {
+    const size_t n = std::min(BoardBatchSize, count - begin);
+    batch->Extract(boards + begin, n);
+
+    // the remap entries are fetched while the slots of earlier boards are accumulated
+    for (size_t bi = 0; bi < std::min(PrefetchDistance, n); bi++) {
+      batch->Prefetch(remap, bi);
+    }
+    for (size_t bi = 0; bi < n; bi++) {
+      if (bi + PrefetchDistance < n) {
+        batch->Prefetch(remap, bi + PrefetchDistance);
+      }
+      const float gradient = gradients[begin + bi];
+      const int stage = stageCount_ == 1 ? 0 : GetStage(batch->discCounts[bi]);
+      float* stageSlots = slots + symmetryRemapTable.canonicalCount * stage;
+      // the batch indices are relative to black
+      for (int fi = 0; fi < FeatureCount; fi++) {
+        const int32_t index = batch->indices[bi][fi];
+        stageSlots[remap[index]] += signs[index] * gradient;
+      }
+      AddGlobalGradient(slots + symmetryRemapTable.canonicalCount * stageCount_, boards[begin + bi], gradient);
+    }
+  }
+}
+
+FeatureIndices::FeatureIndices(const PlayerBoard& board) {
+  const uint64_t player = board.GetPlayerBoard().GetRaw();
+  const uint64_t opponent = board.GetOpponentBoard().GetRaw();
+  for (int fi = 0; fi < FeatureCount; fi++) {
+    const FeatureExtractor& fe = featureExtractionTable.features[fi];
+    indices_[0][fi] = fe.GetIndex(player, opponent);
+    indices_[1][fi] = fe.GetIndex(opponent, player);
+  }
+  for (int fi = FeatureCount; fi < PaddedFeatureCount; fi++) {
+    indices_[0][fi] = 0;
+    indices_[1][fi] = 0;
+  }
+  player_ = 0;
+  discCount_ = PopCount(player | opponent);
+}
+
+bool FeatureIndices::Verify(const PlayerBoard& board) const {
+  // ReferenceCounter adds 1 to the entry of each feature, so each index must find a positive entry,
+  // and all entries are 0 again after that.
+  // The perspective of each player is read from a board where the player is black.
+  thread_local std::unique_ptr<FeatureParameters<uint8_t>> counts(new FeatureParameters<uint8_t>);
+  const Board perspectives[2] = {
+    Board(board.GetPlayerBoard(), board.GetOpponentBoard(), ColorBlack),
+    Board(board.GetOpponentBoard(), board.GetPlayerBoard(), ColorBlack),
+  };
+
+  uint8_t* entries = reinterpret_cast<uint8_t*>(counts.get());
+  bool ok = true;
+  for (int p = 0; p < 2; p++) {
+    ReferenceCounter<>::Add(perspectives[p], counts->weights);
+    const int32_t* indices = indices_[player_ ^ p];
+    for (int fi = 0; fi < FeatureCount; fi++) {
+      if (entries[indices[fi]] > 0) {
+        entries[indices[fi]]--;
+      } else {
+        ok = false;
+      }
+    }
+    if (!ok) {
+      counts->InitZero();
+      return false;
+    }
+  }
+  return discCount_ == (board.GetPlayerBoard() | board.GetOpponentBoard()).Count();
+}
+
+void FeatureIndices::DoMove(const Square& square, const Bitboard& mask) {
+  // from the perspective of the mover, an empty square becomes 1 and a flipped disc changes from 2 to 1,
+  // and from the other perspective, an empty square becomes 2 and a flipped disc changes from 1 to 2
+  int32_t* mover = indices_[player_];
+  int32_t* other = indices_[player_ ^ 1];
+
+  const auto& sf = squareFeatureTable.squares[square.GetRaw()];
+  for (int i = 0; i < sf.count; i++) {
+    mover[sf.deltas[i].feature] += sf.deltas[i].power;
+    other[sf.deltas[i].feature] += 2 * sf.deltas[i].power;
+  }
+
+  for (Square sq : mask) {
+    const auto& sf = squareFeatureTable.squares[sq.GetRaw()];
+    for (int i = 0; i < sf.count; i++) {
+      mover[sf.deltas[i].feature] -= sf.deltas[i].power;
+      other[sf.deltas[i].feature] += sf.deltas[i].power;
+    }
+  }
+  player_ ^= 1;
+  discCount_++;
+}
+
+void FeatureIndices::UndoMove(const Square& square, const Bitboard& mask) {
+  player_ ^= 1;
+  int32_t* mover = indices_[player_];
+  int32_t* other = indices_[player_ ^ 1];
+
+  const auto& sf = squareFeatureTable.squares[square.GetRaw()];
+  for (int i = 0; i < sf.count; i++) {
+    mover[sf.deltas[i].feature] -= sf.deltas[i].power;
+    other[sf.deltas[i].feature] -= 2 * sf.deltas[i].power;
+  }
+
+  for (Square sq : mask) {
+    const auto& sf = squareFeatureTable.squares[sq.GetRaw()];
+    for (int i = 0; i < sf.count; i++) {
+      mover[sf.deltas[i].feature] += sf.deltas[i].power;
+      other[sf.deltas[i].feature] -= sf.deltas[i].power;
+    }
+  }
+  discCount_--;
 }
 
 char Evaluator::EvaluationParamFileName[] = "eval.bin";
 
+Evaluator::Evaluator() : owned_(new PaddedParameters[1]()), params_(1, &owned_[0].params), globalEnabled_(false) {
+}
+
+Evaluator::~Evaluator() = default;
+
+void Evaluator::SetOwned(std::unique_ptr<PaddedParameters[]> owned, int stageCount) {
+  owned_ = std::move(owned);
+  mapped_.reset();
+  params_.resize(stageCount);
+  for (int stage = 0; stage < stageCount; stage++) {
+    params_[stage] = &owned_[stage].params;
+  }
+  quantized_.clear();
+}
+
+void Evaluator::InitZero() {
+  SetOwned(std::unique_ptr<PaddedParameters[]>(new PaddedParameters[GetStageCount()]()), GetStageCount());
+  globals_.InitZero();
+}
+
+void Evaluator::SplitStages() {
+  if (GetStageCount() == StageCount) {
+    return;
+  }
+
+  std::unique_ptr<PaddedParameters[]> owned(new PaddedParameters[StageCount]());
+  for (int stage = 0; stage < StageCount; stage++) {
+    owned[stage].params = *params_[0];
+  }
+  SetOwned(std::move(owned), StageCount);
+}
+
+FeatureParameters<Score>& Evaluator::GetParameters(int stage) {
+  if (mapped_) {
+    std::unique_ptr<PaddedParameters[]> owned(new PaddedParameters[GetStageCount()]());
+    for (int i = 0; i < GetStageCount(); i++) {
+      owned[i].params = *params_[i];
+    }
+    SetOwned(std::move(owned), GetStageCount());
+  }
+  return owned_[stage].params;
+}
+
 const char* Evaluator::SaveParam(const char* fileName) const {
   std::ofstream file(fileName, std::ios::binary);
 
@@ -206,12 +833,37 @@ const char* Evaluator::SaveParam(const char* fileName) const {
     return "ERROR: Filed to open evaluation parameter file";
   }
 
-  file.write(Signature, sizeof(Signature));
+  ParamFileHeader header = {};
+  memcpy(header.magic, ParamFileMagic, sizeof(ParamFileMagic));
+  header.byteOrder = ParamFileByteOrder;
+  // the files without the stages or the global weights are readable by the older versions
+  header.version = GetStageCount() != 1 ? ParamFileStageVersion
+                 : globalEnabled_ ? ParamFileGlobalVersion : ParamFileVersion;
+  header.headerSize = sizeof(ParamFileHeader);
+  header.weightSize = sizeof(Score);
+  header.weightCount = ParamFileWeightCount;
+  header.globalCount = globalEnabled_ ? GlobalParameterCount : 0;
+  header.stageCount = GetStageCount() != 1 ? GetStageCount() : 0;
+  file.write(reinterpret_cast<const char*>(&header), sizeof(header));
 
-  file.write(reinterpret_cast<const char*>(this), sizeof(*this));
+  // the padding also covers the over-read of the gather kernel
+  const char zeros[ParamFileAlignment] = {};
+  for (const auto* params : params_) {
+    file.write(reinterpret_cast<const char*>(params), sizeof(FeatureParameters<Score>));
+    file.write(zeros, ParamFilePaddedWeightSize - sizeof(FeatureParameters<Score>));
+  }
+
+  if (globalEnabled_) {
+    file.write(reinterpret_cast<const char*>(&globals_), sizeof(GlobalParameters));
+    file.write(zeros, ParamFileAlignment - sizeof(GlobalParameters) % ParamFileAlignment);
+  }
 
   file.close();
 
+  if (!file) {
+    return "ERROR: Filed to save evaluation parameter file";
+  }
+
   return nullptr;
 }
 
@@ -222,14 +874,38 @@ const char* Evaluator::LoadParam(const char* fileName) {
     return "ERROR: Filed to open evaluation parameter file";
   }
 
-  char signature[sizeof(Signature)];
-  file.read(signature, sizeof(signature));
+  ParamFileHeader header;
+  file.read(reinterpret_cast<char*>(&header), sizeof(header));
 
-  if (memcmp(signature, Signature, sizeof(Signature)) != 0) {
+  if (!file) {
     return "ERROR: The evaluation parameter file has an invalid signature";
   }
 
-  file.read(reinterpret_cast<char*>(this), sizeof(*this));
+  bool swapped = false;
+  if (memcmp(&header, Signature, sizeof(Signature)) == 0) {
+    // the rest of the header is the weights in the old format
+    header.headerSize = sizeof(Signature);
+    header.globalCount = 0;
+    header.stageCount = 1;
+  } else {
+    auto err = ParseHeader(header, swapped);
+    if (err != nullptr) {
+      return err;
+    }
+  }
+
+  const int stageCount = static_cast<int>(header.stageCount);
+  std::unique_ptr<PaddedParameters[]> owned(new PaddedParameters[stageCount]());
+  for (int stage = 0; stage < stageCount; stage++) {
+    file.seekg(header.headerSize + ParamFilePaddedWeightSize * stage);
+    file.read(reinterpret_cast<char*>(&owned[stage].params), sizeof(FeatureParameters<Score>));
+  }
+
+  GlobalParameters globals;
+  if (header.globalCount != 0) {
+    file.seekg(header.headerSize + ParamFilePaddedWeightSize * stageCount);
+    file.read(reinterpret_cast<char*>(&globals), sizeof(GlobalParameters));
+  }
 
   if (!file) {
     return "ERROR: Filed to load evaluation parameter file";
@@ -237,17 +913,195 @@ const char* Evaluator::LoadParam(const char* fileName) {
 
   file.close();
 
+  if (swapped) {
+    for (int stage = 0; stage < stageCount; stage++) {
+      uint16_t* weights = reinterpret_cast<uint16_t*>(&owned[stage].params);
+      for (uint32_t i = 0; i < ParamFileWeightCount; i++) {
+        weights[i] = SwapBytes(weights[i]);
+      }
+    }
+    uint16_t* globalWeights = reinterpret_cast<uint16_t*>(&globals);
+    for (int i = 0; i < GlobalParameterCount; i++) {
+      globalWeights[i] = SwapBytes(globalWeights[i]);
+    }
+  }
+
+  // the files of the old learning may have the mirror images with different weights
+  for (int stage = 0; stage < stageCount; stage++) {
+    SymmetrizeWeights(reinterpret_cast<Score*>(&owned[stage].params));
+  }
+
+  SetOwned(std::move(owned), stageCount);
+  globals_ = globals;
+  globalEnabled_ = header.globalCount != 0;
+
   return nullptr;
 }
 
-Score Evaluator::Evaluate(const Board& board) {
-  return ExtractFeature<Score, true>(board, *this);
+const char* Evaluator::MapParam(const char* fileName) {
+  std::unique_ptr<MappedFile> mapped(new MappedFile);
+  if (!mapped->Open(fileName)) {
+    return "ERROR: Filed to map evaluation parameter file";
+  }
+
+  ParamFileHeader header;
+  if (mapped->GetSize() < sizeof(header)) {
+    return "ERROR: The evaluation parameter file has an invalid signature";
+  }
+  memcpy(&header, mapped->GetData(), sizeof(header));
+
+  bool swapped = false;
+  auto err = ParseHeader(header, swapped);
+  if (err != nullptr) {
+    return err;
+  }
+
+  if (swapped) {
+    return "ERROR: The evaluation parameter file has the other byte order, and has to be loaded";
+  }
+
+  // the weights and the padding for the gather kernel
+  const int stageCount = static_cast<int>(header.stageCount);
+  const size_t globalOffset = header.headerSize + ParamFilePaddedWeightSize * stageCount;
+  if (mapped->GetSize() < globalOffset
+   || (header.globalCount != 0 && mapped->GetSize() < globalOffset + sizeof(GlobalParameters))) {
+    return "ERROR: The evaluation parameter file is truncated";
+  }
+
+  // the mapped weights cannot be symmetrized like LoadParam does
+  const char* data = static_cast<const char*>(mapped->GetData());
+  for (int stage = 0; stage < stageCount; stage++) {
+    if (!IsSymmetric(reinterpret_cast<const Score*>(data + header.headerSize + ParamFilePaddedWeightSize * stage))) {
+      return "ERROR: The evaluation parameter file is not symmetric, and has to be loaded";
+    }
+  }
+
+  params_.resize(stageCount);
+  for (int stage = 0; stage < stageCount; stage++) {
+    params_[stage] = reinterpret_cast<const FeatureParameters<Score>*>(data + header.headerSize + ParamFilePaddedWeightSize * stage);
+  }
+  mapped_ = std::move(mapped);
+  owned_.reset();
+  quantized_.clear();
+  globals_.InitZero();
+  if (header.globalCount != 0) {
+    memcpy(&globals_, data + globalOffset, sizeof(GlobalParameters));
+  }
+  globalEnabled_ = header.globalCount != 0;
+
+  return nullptr;
+}
+
+Score Evaluator::Evaluate(const Board& board) const {
+  if (network_) {
+    return network_->Evaluate(board);
+  }
+
+  const PlayerBoard playerBoard(board);
+  Score score = Evaluate(FeatureIndices(playerBoard));
+  if (globalEnabled_) {
+    score += EvaluateGlobal(playerBoard);
+  }
+  return board.GetNextDisk() == ColorBlack ? score : -score;
+}
+
+Score Evaluator::Evaluate(const FeatureIndices& indices) const {
+  const int stage = GetStageIndex(indices.GetDiscCount());
+  if (!quantized_.empty()) {
+    const QuantizedParameters& quantized = *quantized_[stage];
+    const int8_t* weights = reinterpret_cast<const int8_t*>(&quantized.weights);
+    return EvaluateQuantizedKernel(weights, quantized.scales, indices.Get());
+  }
+
+  const Type* weights = reinterpret_cast<const Type*>(params_[stage]);
+  return EvaluateKernel(weights, indices.Get());
+}
+
+Score Evaluator::EvaluateGlobal(const PlayerBoard& board) const {
+  if (!globalEnabled_) {
+    return 0;
+  }
+
+  const GlobalFeatureIndices gi(board.GetPlayerBoard(), board.GetOpponentBoard());
+  const Score* weights = reinterpret_cast<const Score*>(&globals_);
+  Score score = 0;
+  for (int i = 0; i < GlobalFeatureCount; i++) {
+    score += weights[gi.indices[i]];
+  }
+  return score;
+}
+
+void Evaluator::Evaluate(const Board* boards, size_t count, Score* scores) const {
+  if (network_) {
+    for (size_t bi = 0; bi < count; bi++) {
+      scores[bi] = network_->Evaluate(boards[bi]);
+    }
+    return;
+  }
+
+  FeatureIndicesBatch* batch = &GetThreadBatch();
+  for (size_t begin = 0; begin < count; begin += BoardBatchSize) {
+    const size_t n = std::min(BoardBatchSize, count - begin);
+    batch->Extract(boards + begin, n);
+
+    if (!quantized_.empty()) {
+      auto weights = [&](size_t bi) {
+        return reinterpret_cast<const int8_t*>(&quantized_[GetStageIndex(batch->discCounts[bi])]->weights);
+      };
+      EvaluateBatch(*batch, n, weights, scores + begin, [&](const int8_t* w, const int32_t* indices, size_t bi) {
+        return EvaluateQuantizedKernel(w, quantized_[GetStageIndex(batch->discCounts[bi])]->scales, indices);
+      });
+    } else {
+      auto weights = [&](size_t bi) {
+        return reinterpret_cast<const Type*>(params_[GetStageIndex(batch->discCounts[bi])]);
+      };
+      EvaluateBatch(*batch, n, weights, scores + begin, [&](const Type* w, const int32_t* indices, size_t) {
+        return EvaluateKernel(w, indices);
+      });
+    }
+  }
+
+  if (globalEnabled_) {
+    for (size_t bi = 0; bi < count; bi++) {
+      const Score global = EvaluateGlobal(PlayerBoard(boards[bi]));
+      scores[bi] += boards[bi].GetNextDisk() == ColorBlack ? global : -global;
+    }
+  }
+}
+
+void Evaluator::Quantize() {
+  std::vector<std::shared_ptr<QuantizedParameters>> quantized;
+  for (const auto* params : params_) {
+    quantized.push_back(QuantizeParameters(reinterpret_cast<const Type*>(params)));
+  }
+  quantized_ = quantized;
 }
 
 void Evaluator::Symmetrize() {
-  beluga::Symmetrize(*this, [](int16_t a, int16_t b) {
-      return a;
-  });
+  for (int stage = 0; stage < GetStageCount(); stage++) {
+    SymmetrizeWeights(reinterpret_cast<Type*>(&GetParameters(stage)));
+  }
+  if (IsQuantized()) {
+    Quantize();
+  }
+}
+
+void Evaluator::Update(const std::vector<Score>& steps) {
+  for (int stage = 0; stage < GetStageCount(); stage++) {
+    Type* weights = reinterpret_cast<Type*>(&GetParameters(stage));
+    const Score* stageSteps = &steps[symmetryRemapTable.canonicalCount * stage];
+    for (int i = 0; i < ParameterCount; i++) {
+      weights[i] += symmetryRemapTable.signs[i] * stageSteps[symmetryRemapTable.remap[i]];
+    }
+  }
+
+  if (globalEnabled_) {
+    Score* globalWeights = reinterpret_cast<Score*>(&globals_);
+    const Score* globalSteps = &steps[symmetryRemapTable.canonicalCount * GetStageCount()];
+    for (int i = 0; i < GlobalParameterCount; i++) {
+      globalWeights[i] += globalSteps[i];
+    }
+  }
 }
 
 std::string Evaluator::StringifyParameters() {
@@ -255,6 +1109,21 @@ std::string Evaluator::StringifyParameters() {
 
   // FIXME
 
+  if (globalEnabled_) {
+    auto print = [&](const char* name, const Score* weights, int count) {
+      oss << name << ":";
+      for (int i = 0; i < count; i++) {
+        oss << " " << weights[i];
+      }
+      oss << "\n";
+    };
+    print("PlayerMobility", globals_.PlayerMobility, 64);
+    print("OpponentMobility", globals_.OpponentMobility, 64);
+    print("PlayerFrontier", globals_.PlayerFrontier, 64);
+    print("OpponentFrontier", globals_.OpponentFrontier, 64);
+    print("Parity", globals_.Parity, 10);
+  }
+
   oss << std::flush;
 
   return oss.str();
@@ -1,14 +1,15 @@
 #pragma once
 
+#include "reversi.h"
+#include "pattern.h"
+#include <memory>
 #include <string>
+#include <vector>
 #include <cstring>
 #include <cstdint>
 
 namespace beluga {
 
-class Board;
-class Bitboard;
-
 using Score = int16_t;
 constexpr int16_t ScoreScale = 100;
 constexpr int16_t ScoreInfinity = 100 * ScoreScale;
@@ -33,43 +34,315 @@ struct FeatureParameters {
     memset(reinterpret_cast<char*>(this), 0, sizeof(*this));
   }
 
-  Type Edge[59049];
-  Type Hor2[6561];
-  Type Hor3[6561];
-  Type Hor4[6561];
-  Type Diag8[6561];
-  Type Diag7[2187];
-  Type Diag6[729];
-  Type Diag5[243];
-  Type Diag4[81];
-  Type Corner3x3[19683];
-  Type Corner5x2[59049];
+  // the weight tables of PatternDefinitions (see GetPatternOffset)
+  Type weights[PatternWeightCount];
+};
+
+// The weights of the global features, which are indexed by the counts of discs or squares
+// instead of patterns. They are relative to the side to move.
+struct GlobalParameters {
+  GlobalParameters() {
+    InitZero();
+  }
+
+  void InitZero() {
+    memset(reinterpret_cast<char*>(this), 0, sizeof(*this));
+  }
+
+  // the number of legal moves
+  Score PlayerMobility[64];
+  Score OpponentMobility[64];
+
+  // the number of discs adjacent to an empty square
+  Score PlayerFrontier[64];
+  Score OpponentFrontier[64];
+
+  // (the number of empties % 2) * 5 + the number of quadrants with odd empties
+  Score Parity[10];
+};
+
+constexpr int GlobalParameterCount = sizeof(GlobalParameters) / sizeof(Score);
+
+// The pattern weights can be split into stages by the number of discs,
+// one stage for every 4 discs.
+constexpr int StageCount = 16;
+
+inline int GetStage(int discCount) {
+  return (discCount - 1) / 4;
+}
+
+// The number of indices rounded up to a multiple of 8 for the SIMD kernels.
+// The padding indices are 0 and never added to the score.
+constexpr int PaddedFeatureCount = (FeatureCount + 7) / 8 * 8;
+
+// The magic multipliers of all features in SoA, for the batch extraction in evaluate_avx2.cpp.
+// The index of a feature is offsets[fi] + ternary[ternaryBases[fi] + binary index of black]
+// + ternary[ternaryBases[fi] + binary index of white] * 2.
+struct FeatureMagicTable {
+  uint64_t masks[FeatureCount];
+  uint64_t magics[FeatureCount];
+  int32_t shifts[FeatureCount];
+  int32_t offsets[FeatureCount];
+  int32_t ternaryBases[FeatureCount];
+
+  // followed by a padding entry for the 32-bit gathers
+  const uint16_t* ternary;
+};
+
+// The indices of all features of a board, which are updated incrementally
+// from the moved square and the flipped discs.
+// Each index is an offset from the beginning of FeatureParameters.
+// The indices are kept from the perspectives of both players, where the digit 1 is
+// a disc of the perspective, and those of the player to move are evaluated.
+// So no colour is needed to update or evaluate them.
+// The number of discs is kept with them to choose the stage of the weights.
+class FeatureIndices {
+public:
+
+  FeatureIndices() = default;
+  explicit FeatureIndices(const PlayerBoard& board);
+  explicit FeatureIndices(const Board& board) : FeatureIndices(PlayerBoard(board)) {}
+
+  // Compares the indices with the square by square extraction, for the self check.
+  bool Verify(const PlayerBoard& board) const;
+
+  // The player to move places a disc on the square.
+  void DoMove(const Square& square, const Bitboard& mask);
+
+  void UndoMove(const Square& square, const Bitboard& mask);
+
+  void Pass() {
+    player_ ^= 1;
+  }
+
+  // the indices from the perspective of the player to move
+  const int32_t* Get() const {
+    return indices_[player_];
+  }
+
+  int GetDiscCount() const {
+    return discCount_;
+  }
+
+private:
+
+  // not over-aligned, because FeatureIndices are kept in vectors and Trees
+  int32_t indices_[2][PaddedFeatureCount];
+
+  // the perspective of the player to move
+  int player_;
+
+  int discCount_;
+
+};
+
+// The weights quantized to int8 with a scale for each weight table,
+// which take half the cache of the int16 weights.
+// They are allocated by MakeAligned.
+struct QuantizedParameters {
+  FeatureParameters<int8_t> weights;
+
+  // the gather kernel loads 4 bytes for each int8 weight
+  int8_t padding[3];
+
+  // the scale of each feature, and 0 for the padding features
+  alignas(32) int32_t scales[PaddedFeatureCount];
 };
 
-class Gradient : public FeatureParameters<float> {
+// The gradient of each equivalence class of the weights under the symmetry of the patterns,
+// such as the mirror images of a line and the exchange of the colours, for each stage,
+// followed by the gradient of GlobalParameters.
+class Gradient {
 public:
+
+  using Type = float;
+
+  // stageCount is Evaluator::GetStageCount()
+  explicit Gradient(int stageCount = 1);
+
   void Add(const Board& board, float gradient);
-  void Symmetrize();
+
+  // Adds gradients[i] for boards[i], in batches with the table lookups prefetched.
+  void Add(const Board* boards, const float* gradients, size_t count);
+
+  size_t GetSize() const {
+    return slots_.size();
+  }
+
+  float Get(size_t slot) const {
+    return slots_[slot];
+  }
+
+private:
+
+  std::vector<float> slots_;
+
+  int stageCount_;
+
 };
 
-class Evaluator : public FeatureParameters<Score> {
+class MappedFile;
+
+class Network;
+
+// The const member functions only read the weights, and many threads can call them
+// at the same time, e.g. the searchers sharing an evaluator by shared_ptr<const Evaluator>.
+// The other member functions change the weights or the layout, and must not run
+// concurrently with any other call on the same evaluator.
+class Evaluator {
 public:
+
+  using Type = Score;
+
   static char EvaluationParamFileName[];
 
+  Evaluator();
+  Evaluator(const Evaluator&) = delete;
+  Evaluator& operator=(const Evaluator&) = delete;
+  ~Evaluator();
+
+  void InitZero();
+
   const char* SaveParam() const {
     return SaveParam(EvaluationParamFileName);
   }
   const char* SaveParam(const char* fileName) const;
+
+  // Reads the parameter file into the memory of this evaluator.
+  // Both the current format and the old signature format are accepted.
+  // The weights of each equivalence class under the symmetry are replaced with their mean,
+  // where the weights of the indices with the colours exchanged are negated.
   const char* LoadParam() {
     return LoadParam(EvaluationParamFileName);
   }
   const char* LoadParam(const char* fileName);
 
-  Score Evaluate(const Board& board);
+  // Maps the parameter file read-only and evaluates with the weights in place,
+  // so the processes on a host share one copy in the page cache.
+  // The file has to be in the current format and the native byte order,
+  // and its weights have to be symmetric.
+  const char* MapParam() {
+    return MapParam(EvaluationParamFileName);
+  }
+  const char* MapParam(const char* fileName);
+
+  bool IsMapped() const {
+    return mapped_ != nullptr;
+  }
+
+  // 1, or StageCount after SplitStages or after a parameter file with the stages is loaded.
+  int GetStageCount() const {
+    return static_cast<int>(params_.size());
+  }
+
+  // Copies the weights into StageCount stages, which are evaluated and trained separately.
+  void SplitStages();
+
+  // stage is less than GetStageCount()
+  const FeatureParameters<Score>& GetParameters(int stage = 0) const {
+    return *params_[stage];
+  }
+
+  // The mapped weights are copied into the memory of this evaluator before they are changed.
+  FeatureParameters<Score>& GetParameters(int stage = 0);
+
+  // The sum of the pattern features and the global features, or the network, relative to black.
+  Score Evaluate(const Board& board) const;
 
+  // The pattern features only, relative to the player to move.
+  // The pattern weights of a class with the colours exchanged are negated (see LoadParam),
+  // so the weights relative to black are also relative to the player of the digit 1.
+  Score Evaluate(const FeatureIndices& indices) const;
+
+  // Evaluates many boards at once into scores[0..count), with the same results as
+  // Evaluate(const Board&). The indices are extracted for a batch of boards
+  // before the weights are read, and the weights of the next boards are prefetched.
+  void Evaluate(const Board* boards, size_t count, Score* scores) const;
+
+  // Evaluate uses the int8 weights converted from the current weights
+  // until the next LoadParam. Call it again after the weights are changed.
+  // The global weights are not quantized.
+  void Quantize();
+
+  // Replaces the weights of each equivalence class with their mean as LoadParam does,
+  // e.g. after the weights are set without Update.
   void Symmetrize();
 
+  bool IsQuantized() const {
+    return !quantized_.empty();
+  }
+
+  // The global features are evaluated after EnableGlobalFeatures(true),
+  // or after a parameter file with the global weights is loaded.
+  void EnableGlobalFeatures(bool enabled) {
+    globalEnabled_ = enabled;
+  }
+
+  bool IsGlobalFeaturesEnabled() const {
+    return globalEnabled_;
+  }
+
+  const GlobalParameters& GetGlobalParameters() const {
+    return globals_;
+  }
+
+  GlobalParameters& GetGlobalParameters() {
+    return globals_;
+  }
+
+  // The score of the global features relative to the side to move,
+  // or 0 if they are disabled.
+  Score EvaluateGlobal(const PlayerBoard& board) const;
+
+  // The network replaces the pattern features and the global features while it is set,
+  // and Searcher updates the accumulator of the network instead of the feature indices.
+  void SetNetwork(const std::shared_ptr<const Network>& network) {
+    network_ = network;
+  }
+
+  const std::shared_ptr<const Network>& GetNetwork() const {
+    return network_;
+  }
+
+  // Adds the step of each slot of Gradient to all weights of the equivalence class,
+  // which keeps the symmetric weights equal.
+  // The steps of the global weights are ignored while they are disabled.
+  void Update(const std::vector<Score>& steps);
+
   std::string StringifyParameters();
+
+private:
+
+  // The gather kernel loads 4 bytes for each int16 weight,
+  // so the last weight needs 2 readable bytes after it.
+  struct PaddedParameters {
+    FeatureParameters<Score> params;
+    Score padding[2];
+  };
+
+  void SetOwned(std::unique_ptr<PaddedParameters[]> owned, int stageCount);
+
+  int GetStageIndex(int discCount) const {
+    return params_.size() == 1 ? 0 : GetStage(discCount);
+  }
+
+  std::unique_ptr<PaddedParameters[]> owned_;
+
+  std::unique_ptr<MappedFile> mapped_;
+
+  // the weights of each stage in owned_ or mapped_
+  std::vector<const FeatureParameters<Score>*> params_;
+
+  // the int8 weights of each stage, or empty
+  std::vector<std::shared_ptr<QuantizedParameters>> quantized_;
+
+  // the global weights are always owned, even if the pattern weights are mapped
+  GlobalParameters globals_;
+
+  bool globalEnabled_;
+
+  std::shared_ptr<const Network> network_;
+
 };
 
 } // namespace beluga
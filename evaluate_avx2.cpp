@@ -0,0 +1,109 @@
+#include "evaluate.h"
+
+#if defined(__x86_64__) || defined(_M_X64)
+
+#include <immintrin.h>
+
+namespace {
+
+// gathers 8 int16 weights as the low halves of 32-bit loads and sign-extends them
+inline __m256i Gather(const int* base, __m256i indices) {
+  __m256i x = _mm256_i32gather_epi32(base, indices, 2);
+  return _mm256_srai_epi32(_mm256_slli_epi32(x, 16), 16);
+}
+
+// the binary indices of the masked discs of 4 boards, which are (bits & mask) * magic >> shift
+inline __m256i GetBinaryIndices(__m256i bits, __m256i mask, __m256i magicLow, __m256i magicHigh, __m128i shift) {
+  // the low 64 bits of the product from the 32-bit partial products
+  bits = _mm256_and_si256(bits, mask);
+  const __m256i low = _mm256_mul_epu32(bits, magicLow);
+  const __m256i cross = _mm256_add_epi64(_mm256_mul_epu32(_mm256_srli_epi64(bits, 32), magicLow), _mm256_mul_epu32(bits, magicHigh));
+  return _mm256_srl_epi64(_mm256_add_epi64(low, _mm256_slli_epi64(cross, 32)), shift);
+}
+
+inline int ReduceAdd(__m256i x) {
+  __m128i y = _mm_add_epi32(_mm256_castsi256_si128(x), _mm256_extracti128_si256(x, 1));
+  y = _mm_add_epi32(y, _mm_shuffle_epi32(y, _MM_SHUFFLE(1, 0, 3, 2)));
+  y = _mm_add_epi32(y, _mm_shuffle_epi32(y, _MM_SHUFFLE(2, 3, 0, 1)));
+  return _mm_cvtsi128_si32(y);
+}
+
+} // namespace
+
+namespace beluga {
+
+namespace avx2 {
+
+Score Evaluate(const Score* weights, const int32_t* indices) {
+  const int* base = reinterpret_cast<const int*>(weights);
+  const __m256i* p = reinterpret_cast<const __m256i*>(indices);
+
+  // two sums hide the latency of the gathers
+  __m256i sum0 = _mm256_setzero_si256();
+  __m256i sum1 = _mm256_setzero_si256();
+  int i = 0;
+  for (; i + 2 <= FeatureCount / 8; i += 2) {
+    sum0 = _mm256_add_epi32(sum0, Gather(base, _mm256_loadu_si256(p + i)));
+    sum1 = _mm256_add_epi32(sum1, Gather(base, _mm256_loadu_si256(p + i + 1)));
+  }
+  if (i < FeatureCount / 8) {
+    sum0 = _mm256_add_epi32(sum0, Gather(base, _mm256_loadu_si256(p + i)));
+  }
+
+  // the padding lanes of the last vector are masked
+  if (FeatureCount % 8 != 0) {
+    const __m256i mask = _mm256_cmpgt_epi32(_mm256_set1_epi32(FeatureCount % 8), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+    __m256i last = _mm256_mask_i32gather_epi32(_mm256_setzero_si256(), base, _mm256_loadu_si256(p + FeatureCount / 8), mask, 2);
+    sum1 = _mm256_add_epi32(sum1, _mm256_srai_epi32(_mm256_slli_epi32(last, 16), 16));
+  }
+
+  return static_cast<Score>(ReduceAdd(_mm256_add_epi32(sum0, sum1)));
+}
+
+// The boards are read and written in groups of 4, so the arrays have to be rounded up to 4 boards.
+void ExtractIndices(const uint64_t* black, const uint64_t* white, size_t count, const FeatureMagicTable& table,
+                    int32_t (*indices)[PaddedFeatureCount]) {
+  const int* base = reinterpret_cast<const int*>(table.ternary);
+  const __m128i low16 = _mm_set1_epi32(0xffff);
+  for (int fi = 0; fi < FeatureCount; fi++) {
+    const __m256i mask = _mm256_set1_epi64x(static_cast<long long>(table.masks[fi]));
+    const __m256i magicLow = _mm256_set1_epi64x(static_cast<long long>(table.magics[fi]));
+    const __m256i magicHigh = _mm256_set1_epi64x(static_cast<long long>(table.magics[fi] >> 32));
+    const __m128i shift = _mm_cvtsi32_si128(table.shifts[fi]);
+    const __m256i ternaryBase = _mm256_set1_epi64x(table.ternaryBases[fi]);
+    const __m128i offset = _mm_set1_epi32(table.offsets[fi]);
+    for (size_t bi = 0; bi < count; bi += 4) {
+      // the uint16 ternary indices are gathered as the low halves of 32-bit loads
+      const __m256i bb = _mm256_add_epi64(GetBinaryIndices(_mm256_load_si256(reinterpret_cast<const __m256i*>(black + bi)), mask, magicLow, magicHigh, shift), ternaryBase);
+      const __m256i bw = _mm256_add_epi64(GetBinaryIndices(_mm256_load_si256(reinterpret_cast<const __m256i*>(white + bi)), mask, magicLow, magicHigh, shift), ternaryBase);
+      const __m128i tb = _mm_and_si128(_mm256_i64gather_epi32(base, bb, 2), low16);
+      const __m128i tw = _mm_and_si128(_mm256_i64gather_epi32(base, bw, 2), low16);
+      const __m128i index = _mm_add_epi32(_mm_add_epi32(offset, tb), _mm_slli_epi32(tw, 1));
+      indices[bi][fi] = _mm_cvtsi128_si32(index);
+      indices[bi + 1][fi] = _mm_extract_epi32(index, 1);
+      indices[bi + 2][fi] = _mm_extract_epi32(index, 2);
+      indices[bi + 3][fi] = _mm_extract_epi32(index, 3);
+    }
+  }
+}
+
+Score EvaluateQuantized(const int8_t* weights, const int32_t* scales, const int32_t* indices) {
+  const int* base = reinterpret_cast<const int*>(weights);
+  const __m256i* p = reinterpret_cast<const __m256i*>(indices);
+  const __m256i* s = reinterpret_cast<const __m256i*>(scales);
+
+  // the padding lanes have index 0 and scale 0
+  __m256i sum = _mm256_setzero_si256();
+  for (int i = 0; i < PaddedFeatureCount / 8; i++) {
+    __m256i x = _mm256_i32gather_epi32(base, _mm256_loadu_si256(p + i), 1);
+    x = _mm256_srai_epi32(_mm256_slli_epi32(x, 24), 24);
+    sum = _mm256_add_epi32(sum, _mm256_mullo_epi32(x, _mm256_loadu_si256(s + i)));
+  }
+  return static_cast<Score>(ReduceAdd(sum));
+}
+
+} // namespace avx2
+
+} // namespace beluga
+
+#endif
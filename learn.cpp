@@ -1,16 +1,38 @@
 #include "search.h"
+#include "network.h"
+#include <algorithm>
 #include <list>
+#include <vector>
 #include <iostream>
 #include <random>
 #include <cmath>
+#include <cstring>
 
 using namespace beluga;
 
 std::mt19937 r(static_cast<unsigned>(time(nullptr)));
 
-void Learn(std::shared_ptr<Evaluator> eval, int gameCount, int depth, int endingDepth, int updateCount);
+void Learn(std::shared_ptr<Evaluator> eval, std::shared_ptr<Network> network, int gameCount, int depth, int endingDepth, int updateCount, bool quantized);
+
+void AdjustNetwork(Network& network, const std::vector<Board>& boards, const std::vector<Score>& scores, int updateCount);
+
+int main(int argc, const char** argv, const char**) {
+  // "learn quantized" trains the weights for the int8 evaluator (see Evaluator::Quantize),
+  // which the engine uses when it is started with --quantized,
+  // "learn global" also trains the mobility, frontier and parity weights (see GlobalParameters),
+  // "learn staged" trains the weights of each stage on the samples of the stage,
+  // and "learn network" trains the network instead of the pattern weights (see Network).
+  bool quantized = false;
+  bool global = false;
+  bool staged = false;
+  bool useNetwork = false;
+  for (int i = 1; i < argc; i++) {
+    quantized = quantized || strcmp(argv[i], "quantized") == 0;
+    global = global || strcmp(argv[i], "global") == 0;
+    staged = staged || strcmp(argv[i], "staged") == 0;
+    useNetwork = useNetwork || strcmp(argv[i], "network") == 0;
+  }
 
-int main(int, const char**, const char**) {
   std::shared_ptr<Evaluator> eval(new Evaluator);
 
   auto err = eval->LoadParam();
@@ -19,26 +41,52 @@ int main(int, const char**, const char**) {
     std::cerr << "eval.bin has not loaded, and initialized by zero" << std::endl;
     eval->InitZero();
   }
+  if (global) {
+    eval->EnableGlobalFeatures(true);
+  }
+  if (staged) {
+    eval->SplitStages();
+  }
+
+  // the samples are generated by the search with the network
+  std::shared_ptr<Network> network;
+  if (useNetwork) {
+    network.reset(new Network);
+    auto err = network->LoadParam();
+    if (err != nullptr) {
+      std::cerr << err << std::endl;
+      std::cerr << "network.bin has not loaded, and initialized by random weights" << std::endl;
+      network->InitRandom(static_cast<uint32_t>(r()));
+    }
+    eval->SetNetwork(network);
+  }
 
   for (int i = 0; i < 10; i++) {
-    Learn(eval, 100000, 3, 10, 256);
+    Learn(eval, network, 100000, 3, 10, 256, quantized);
   }
 
   return 0;
 }
 
-struct Sample {
-  Board board;
-  Score score;
-};
-
-void Learn(std::shared_ptr<Evaluator> eval, int gameCount, int depth, int endingDepth, int updateCount) {
+void Learn(std::shared_ptr<Evaluator> eval, std::shared_ptr<Network> network, int gameCount, int depth, int endingDepth, int updateCount, bool quantized) {
   std::cout << "begin Learn" << std::endl;
   std::cout << "gameCount  : " << gameCount << std::endl;
   std::cout << "updateCount: " << updateCount << std::endl;
+  std::cout << "quantized  : " << (quantized ? "yes" : "no") << std::endl;
+  std::cout << "global     : " << (eval->IsGlobalFeaturesEnabled() ? "yes" : "no") << std::endl;
+  std::cout << "stages     : " << eval->GetStageCount() << std::endl;
+  std::cout << "network    : " << (network ? "yes" : "no") << std::endl;
+
+  // The losses are measured with the int8 weights, and the steps are applied to the int16 weights.
+  // The saved weights are quantized in the same way when they are loaded.
+  if (quantized) {
+    eval->Quantize();
+  }
 
   // generate samples
-  std::list<Sample> samples;
+  // The boards and the scores are kept in separate arrays for the batch evaluation.
+  std::vector<Board> sampleBoards;
+  std::vector<Score> sampleScores;
 
   Searcher searcher(eval);
   for (int i = 0; i < gameCount; i++) {
@@ -74,32 +122,48 @@ void Learn(std::shared_ptr<Evaluator> eval, int gameCount, int depth, int ending
 
     Score score = (board.GetBlackBoard().Count() - board.GetWhiteBoard().Count()) * ScoreScale;
     for (auto b : boards) {
-      samples.push_back({ b, score });
+      sampleBoards.push_back(b);
+      sampleScores.push_back(score);
     }
   }
   std::cout << "\rgenerating samples...done                 " << std::endl;
 
+  if (network) {
+    AdjustNetwork(*network, sampleBoards, sampleScores, updateCount);
+
+    auto err = network->SaveParam();
+    if (err != nullptr) {
+      std::cerr << "ERROR: " << err << std::endl;
+    }
+
+    std::cout << "end LearnBatch" << std::endl;
+    return;
+  }
+
   // adjust
   std::cout << "adjusting..." << std::flush;
   std::uniform_int_distribution<Score> s(0, 1);
+  std::vector<Score> staticScores(sampleBoards.size());
+  std::vector<float> gradients(sampleBoards.size());
   for (int bi = 0; bi < updateCount; bi++) {
     float lossSum = 0.0f;
     int lossCount = 0;
-    Gradient gradient;
-    for (auto sample : samples) {
-        auto staticScore = eval->Evaluate(sample.board);
-        float loss = static_cast<float>(sample.score - staticScore) / static_cast<float>(ScoreScale);
-        auto g = loss * (1e-4f);
-        gradient.Add(sample.board, g);
+    eval->Evaluate(sampleBoards.data(), sampleBoards.size(), staticScores.data());
+    for (size_t i = 0; i < sampleBoards.size(); i++) {
+        float loss = static_cast<float>(sampleScores[i] - staticScores[i]) / static_cast<float>(ScoreScale);
+        gradients[i] = loss * (1e-4f);
 
         lossSum += std::fabs(loss);
         lossCount++;
     }
-    gradient.Symmetrize();
+    // the samples of each stage only change the slots of the stage
+    Gradient gradient(eval->GetStageCount());
+    gradient.Add(sampleBoards.data(), gradients.data(), sampleBoards.size());
 
-    for (unsigned i = 0; i < sizeof(Gradient) / sizeof(typename Gradient::Type); i++) {
+    std::vector<Score> steps(gradient.GetSize());
+    for (size_t i = 0; i < gradient.GetSize(); i++) {
       const float norm = 1e-3f;
-      auto g = reinterpret_cast<Gradient::Type*>(&gradient)[i];
+      auto g = gradient.Get(i);
       g += g > 0.0f ? -norm : g < 0.0f ? norm : 0.0f;
       Score step = 0;
       if (g > 0.0f) {
@@ -107,9 +171,12 @@ void Learn(std::shared_ptr<Evaluator> eval, int gameCount, int depth, int ending
       } else if (g < 0.0f) {
         step = -(s(r) + s(r));
       }
-      reinterpret_cast<Evaluator::Type*>(eval.get())[i] += step;
+      steps[i] = step;
+    }
+    eval->Update(steps);
+    if (quantized) {
+      eval->Quantize();
     }
-    eval->Symmetrize();
 
     float lossAve = lossSum / static_cast<float>(lossCount);
     std::cout << "[" << bi << "]loss=" << lossAve << "..." << std::flush;
@@ -125,3 +192,33 @@ void Learn(std::shared_ptr<Evaluator> eval, int gameCount, int depth, int ending
 
   std::cout << "end LearnBatch" << std::endl;
 }
+
+// Trains the float weights of the network by the gradient descent on minibatches of the shuffled samples.
+// Unlike the pattern weights, the loss is measured with the float weights before each step.
+void AdjustNetwork(Network& network, const std::vector<Board>& boards, const std::vector<Score>& scores, int updateCount) {
+  const size_t batchSize = 256;
+  const float learningRate = 1e-2f;
+
+  std::cout << "adjusting..." << std::flush;
+  std::vector<size_t> order(boards.size());
+  for (size_t i = 0; i < order.size(); i++) {
+    order[i] = i;
+  }
+  NetworkGradient gradient;
+  for (int bi = 0; bi < updateCount; bi++) {
+    std::shuffle(order.begin(), order.end(), r);
+    float lossSum = 0.0f;
+    for (size_t begin = 0; begin < order.size(); begin += batchSize) {
+      gradient.Clear();
+      for (size_t i = begin; i < std::min(order.size(), begin + batchSize); i++) {
+        const float target = static_cast<float>(scores[order[i]]) / static_cast<float>(ScoreScale);
+        lossSum += std::fabs(gradient.Add(network, boards[order[i]], target));
+      }
+      network.Update(gradient, learningRate);
+    }
+
+    float lossAve = lossSum / static_cast<float>(order.size());
+    std::cout << "[" << bi << "]loss=" << lossAve << "..." << std::flush;
+  }
+  std::cout << "done" << std::endl;
+}
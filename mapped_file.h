@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+
+namespace beluga {
+
+// A read-only memory mapping of a whole file.
+// The pages are shared with the other processes which map the same file.
+class MappedFile {
+public:
+
+  MappedFile();
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+  ~MappedFile();
+
+  bool Open(const char* fileName);
+
+  void Close();
+
+  const void* GetData() const {
+    return data_;
+  }
+
+  size_t GetSize() const {
+    return size_;
+  }
+
+private:
+
+  const void* data_;
+  size_t size_;
+#if defined(_WIN32)
+  void* mapping_;
+#endif
+
+};
+
+} // namespace beluga
@@ -0,0 +1,453 @@
+#include "network.h"
+#include "cpu.h"
+#include <fstream>
+#include <algorithm>
+#include <random>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+namespace {
+
+// The file is the header followed by the float weights of NetworkParameters in the byte order of the writer.
+struct NetworkFileHeader {
+  char magic[8];
+  uint32_t byteOrder; // NetworkFileByteOrder in the byte order of the writer
+  uint32_t version;
+  uint32_t inputCount;
+  uint32_t accumulatorSize;
+  uint32_t hiddenSize;
+  uint32_t reserved[3];
+};
+
+const char NetworkFileMagic[8] = { 'b', 'e', 'l', 'u', 'g', 'a', 'N', 'N' };
+constexpr uint32_t NetworkFileByteOrder = 0x01020304;
+constexpr uint32_t NetworkFileVersion = 1;
+
+uint32_t SwapBytes(uint32_t x) {
+  return (x >> 24) | ((x >> 8) & 0xff00) | ((x << 8) & 0xff0000) | (x << 24);
+}
+
+// The accumulator of the bias and 64 discs fits in int16.
+constexpr int MaxInputWeight = INT16_MAX / (64 + 1);
+constexpr int MaxHiddenWeight = INT8_MAX;
+
+// the scale of the hidden biases and the output
+constexpr int OutputScale = beluga::NetworkActivationScale * beluga::NetworkWeightScale;
+
+inline int Clip(int x) {
+  return std::max(0, std::min(beluga::NetworkActivationScale, x));
+}
+
+inline float Clip(float x) {
+  return std::max(0.0f, std::min(1.0f, x));
+}
+
+inline int32_t Round(float x) {
+  return static_cast<int32_t>(std::lround(x));
+}
+
+inline void AddRow(int16_t* values, const int16_t* row) {
+  for (int i = 0; i < beluga::NetworkAccumulatorSize; i++) {
+    values[i] = static_cast<int16_t>(values[i] + row[i]);
+  }
+}
+
+inline void SubRow(int16_t* values, const int16_t* row) {
+  for (int i = 0; i < beluga::NetworkAccumulatorSize; i++) {
+    values[i] = static_cast<int16_t>(values[i] - row[i]);
+  }
+}
+
+} // namespace
+
+namespace beluga {
+
+#if BELUGA_AVX2
+namespace avx2 {
+
+// defined in network_avx2.cpp
+int32_t Propagate(const QuantizedNetwork& weights, const int16_t* player, const int16_t* opponent);
+
+} // namespace avx2
+#endif
+
+// The layers after the accumulators, which returns the output multiplied by OutputScale.
+int32_t PropagatePortable(const QuantizedNetwork& weights, const int16_t* player, const int16_t* opponent) {
+  uint8_t inputs[NetworkAccumulatorSize * 2];
+  for (int i = 0; i < NetworkAccumulatorSize; i++) {
+    inputs[i] = static_cast<uint8_t>(Clip(player[i]));
+    inputs[NetworkAccumulatorSize + i] = static_cast<uint8_t>(Clip(opponent[i]));
+  }
+
+  int32_t output = weights.outputBias;
+  for (int j = 0; j < NetworkHiddenSize; j++) {
+    int32_t sum = weights.hiddenBiases[j];
+    for (int i = 0; i < NetworkAccumulatorSize * 2; i++) {
+      sum += inputs[i] * weights.hiddenWeights[j][i];
+    }
+    // a negative sum is clipped to 0 regardless of the rounding
+    output += Clip(sum / NetworkWeightScale) * weights.outputWeights[j];
+  }
+  return output;
+}
+
+using PropagateFunc = int32_t (*)(const QuantizedNetwork& weights, const int16_t* player, const int16_t* opponent);
+
+// the same selection as the kernels of the pattern evaluator
+PropagateFunc PropagateKernel = PropagatePortable;
+
+struct NetworkKernelSelector {
+  NetworkKernelSelector() {
+#if BELUGA_AVX2
+    if (GetCpuFeatures().avx2) {
+      PropagateKernel = avx2::Propagate;
+    }
+#endif
+  }
+} networkKernelSelector;
+
+NetworkAccumulator::NetworkAccumulator(const Network& network, const PlayerBoard& board) {
+  const QuantizedNetwork& weights = network.GetQuantized();
+  for (int p = 0; p < 2; p++) {
+    int16_t* values = values_[p];
+    const Bitboard player = p == 0 ? board.GetPlayerBoard() : board.GetOpponentBoard();
+    const Bitboard opponent = p == 0 ? board.GetOpponentBoard() : board.GetPlayerBoard();
+    memcpy(values, weights.inputBiases, sizeof(weights.inputBiases));
+    for (Square sq : player) {
+      AddRow(values, weights.inputWeights[sq.GetRaw()]);
+    }
+    for (Square sq : opponent) {
+      AddRow(values, weights.inputWeights[64 + sq.GetRaw()]);
+    }
+  }
+  player_ = 0;
+}
+
+bool NetworkAccumulator::Verify(const Network& network, const PlayerBoard& board) const {
+  const NetworkAccumulator expected(network, board);
+  return memcmp(GetPlayer(), expected.GetPlayer(), sizeof(values_[0])) == 0 &&
+    memcmp(GetOpponent(), expected.GetOpponent(), sizeof(values_[1])) == 0;
+}
+
+void NetworkAccumulator::DoMove(const Network& network, const Square& square, const Bitboard& mask) {
+  // the placed disc is a player disc of the mover, and the flipped discs change from the opponent to the player
+  const QuantizedNetwork& weights = network.GetQuantized();
+  int16_t* mover = values_[player_];
+  int16_t* other = values_[player_ ^ 1];
+
+  AddRow(mover, weights.inputWeights[square.GetRaw()]);
+  AddRow(other, weights.inputWeights[64 + square.GetRaw()]);
+  for (Square sq : mask) {
+    AddRow(mover, weights.flipWeights[sq.GetRaw()]);
+    SubRow(other, weights.flipWeights[sq.GetRaw()]);
+  }
+  player_ ^= 1;
+}
+
+void NetworkAccumulator::UndoMove(const Network& network, const Square& square, const Bitboard& mask) {
+  player_ ^= 1;
+  const QuantizedNetwork& weights = network.GetQuantized();
+  int16_t* mover = values_[player_];
+  int16_t* other = values_[player_ ^ 1];
+
+  SubRow(mover, weights.inputWeights[square.GetRaw()]);
+  SubRow(other, weights.inputWeights[64 + square.GetRaw()]);
+  for (Square sq : mask) {
+    SubRow(mover, weights.flipWeights[sq.GetRaw()]);
+    AddRow(other, weights.flipWeights[sq.GetRaw()]);
+  }
+}
+
+NetworkGradient::NetworkGradient() : slots_(new NetworkParameters()), count_(0) {
+}
+
+void NetworkGradient::Clear() {
+  memset(slots_.get(), 0, sizeof(NetworkParameters));
+  count_ = 0;
+}
+
+float NetworkGradient::Add(const Network& network, const Board& board, float target) {
+  const NetworkParameters& params = network.GetParameters();
+  const PlayerBoard playerBoard(board);
+
+  // the forward pass with the float weights, where inputs[0..) is the side to move
+  float accumulators[NetworkAccumulatorSize * 2];
+  for (int i = 0; i < NetworkAccumulatorSize; i++) {
+    accumulators[i] = params.inputBiases[i];
+    accumulators[NetworkAccumulatorSize + i] = params.inputBiases[i];
+  }
+  for (Square sq : playerBoard.GetPlayerBoard()) {
+    for (int i = 0; i < NetworkAccumulatorSize; i++) {
+      accumulators[i] += params.inputWeights[sq.GetRaw()][i];
+      accumulators[NetworkAccumulatorSize + i] += params.inputWeights[64 + sq.GetRaw()][i];
+    }
+  }
+  for (Square sq : playerBoard.GetOpponentBoard()) {
+    for (int i = 0; i < NetworkAccumulatorSize; i++) {
+      accumulators[i] += params.inputWeights[64 + sq.GetRaw()][i];
+      accumulators[NetworkAccumulatorSize + i] += params.inputWeights[sq.GetRaw()][i];
+    }
+  }
+
+  float inputs[NetworkAccumulatorSize * 2];
+  for (int i = 0; i < NetworkAccumulatorSize * 2; i++) {
+    inputs[i] = Clip(accumulators[i]);
+  }
+
+  float sums[NetworkHiddenSize];
+  float output = params.outputBias;
+  for (int j = 0; j < NetworkHiddenSize; j++) {
+    sums[j] = params.hiddenBiases[j];
+    for (int i = 0; i < NetworkAccumulatorSize * 2; i++) {
+      sums[j] += params.hiddenWeights[j][i] * inputs[i];
+    }
+    output += params.outputWeights[j] * Clip(sums[j]);
+  }
+
+  // the backward pass of the error relative to the side to move
+  const float sign = board.GetNextDisk() == ColorBlack ? 1.0f : -1.0f;
+  const float error = target - output * sign;
+  const float g = error * sign;
+
+  NetworkParameters& slots = *slots_;
+  float inputGradients[NetworkAccumulatorSize * 2] = {};
+  slots.outputBias += g;
+  for (int j = 0; j < NetworkHiddenSize; j++) {
+    slots.outputWeights[j] += g * Clip(sums[j]);
+    if (sums[j] <= 0.0f || sums[j] >= 1.0f) {
+      continue;
+    }
+    const float sumGradient = g * params.outputWeights[j];
+    slots.hiddenBiases[j] += sumGradient;
+    for (int i = 0; i < NetworkAccumulatorSize * 2; i++) {
+      slots.hiddenWeights[j][i] += sumGradient * inputs[i];
+      inputGradients[i] += sumGradient * params.hiddenWeights[j][i];
+    }
+  }
+
+  for (int i = 0; i < NetworkAccumulatorSize * 2; i++) {
+    if (accumulators[i] <= 0.0f || accumulators[i] >= 1.0f) {
+      inputGradients[i] = 0.0f;
+    }
+  }
+  for (int i = 0; i < NetworkAccumulatorSize; i++) {
+    slots.inputBiases[i] += inputGradients[i] + inputGradients[NetworkAccumulatorSize + i];
+  }
+  for (Square sq : playerBoard.GetPlayerBoard()) {
+    for (int i = 0; i < NetworkAccumulatorSize; i++) {
+      slots.inputWeights[sq.GetRaw()][i] += inputGradients[i];
+      slots.inputWeights[64 + sq.GetRaw()][i] += inputGradients[NetworkAccumulatorSize + i];
+    }
+  }
+  for (Square sq : playerBoard.GetOpponentBoard()) {
+    for (int i = 0; i < NetworkAccumulatorSize; i++) {
+      slots.inputWeights[64 + sq.GetRaw()][i] += inputGradients[i];
+      slots.inputWeights[sq.GetRaw()][i] += inputGradients[NetworkAccumulatorSize + i];
+    }
+  }
+
+  count_++;
+  return error;
+}
+
+char Network::NetworkParamFileName[] = "network.bin";
+
+Network::Network() : params_(new NetworkParameters()), quantized_(MakeAligned<QuantizedNetwork>()) {
+  Quantize();
+}
+
+Network::~Network() = default;
+
+void Network::InitZero() {
+  memset(params_.get(), 0, sizeof(NetworkParameters));
+  Quantize();
+}
+
+void Network::InitRandom(uint32_t seed) {
+  // the accumulators and the hidden sums start around the middle of the clipped range
+  std::mt19937 rng(seed);
+  std::normal_distribution<float> input(0.0f, 0.1f);
+  std::normal_distribution<float> hidden(0.0f, 1.0f / std::sqrt(static_cast<float>(NetworkAccumulatorSize * 2)));
+  std::normal_distribution<float> output(0.0f, 1.0f);
+
+  NetworkParameters& params = *params_;
+  for (auto& row : params.inputWeights) {
+    for (float& w : row) {
+      w = input(rng);
+    }
+  }
+  for (float& b : params.inputBiases) {
+    b = 0.5f;
+  }
+  for (auto& row : params.hiddenWeights) {
+    for (float& w : row) {
+      w = hidden(rng);
+    }
+  }
+  for (float& b : params.hiddenBiases) {
+    b = 0.5f;
+  }
+  for (float& w : params.outputWeights) {
+    w = output(rng);
+  }
+  params.outputBias = 0.0f;
+  Quantize();
+}
+
+const char* Network::SaveParam(const char* fileName) const {
+  std::ofstream file(fileName, std::ios::binary);
+
+  if (!file) {
+    return "ERROR: Filed to open network parameter file";
+  }
+
+  NetworkFileHeader header = {};
+  memcpy(header.magic, NetworkFileMagic, sizeof(NetworkFileMagic));
+  header.byteOrder = NetworkFileByteOrder;
+  header.version = NetworkFileVersion;
+  header.inputCount = NetworkInputCount;
+  header.accumulatorSize = NetworkAccumulatorSize;
+  header.hiddenSize = NetworkHiddenSize;
+  file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  file.write(reinterpret_cast<const char*>(params_.get()), sizeof(NetworkParameters));
+
+  file.close();
+
+  if (!file) {
+    return "ERROR: Filed to save network parameter file";
+  }
+
+  return nullptr;
+}
+
+const char* Network::LoadParam(const char* fileName) {
+  std::ifstream file(fileName, std::ios::binary);
+
+  if (!file) {
+    return "ERROR: Filed to open network parameter file";
+  }
+
+  NetworkFileHeader header;
+  file.read(reinterpret_cast<char*>(&header), sizeof(header));
+
+  if (!file || memcmp(header.magic, NetworkFileMagic, sizeof(NetworkFileMagic)) != 0) {
+    return "ERROR: The network parameter file has an invalid signature";
+  }
+
+  const bool swapped = header.byteOrder != NetworkFileByteOrder;
+  if (swapped) {
+    header.byteOrder = SwapBytes(header.byteOrder);
+    header.version = SwapBytes(header.version);
+    header.inputCount = SwapBytes(header.inputCount);
+    header.accumulatorSize = SwapBytes(header.accumulatorSize);
+    header.hiddenSize = SwapBytes(header.hiddenSize);
+    if (header.byteOrder != NetworkFileByteOrder) {
+      return "ERROR: The network parameter file has an unknown byte order";
+    }
+  }
+
+  if (header.version != NetworkFileVersion) {
+    return "ERROR: The network parameter file has an unsupported version";
+  }
+
+  if (header.inputCount != NetworkInputCount
+   || header.accumulatorSize != NetworkAccumulatorSize
+   || header.hiddenSize != NetworkHiddenSize) {
+    return "ERROR: The network parameter file has an unexpected layout";
+  }
+
+  std::unique_ptr<NetworkParameters> params(new NetworkParameters());
+  file.read(reinterpret_cast<char*>(params.get()), sizeof(NetworkParameters));
+
+  if (!file) {
+    return "ERROR: Filed to load network parameter file";
+  }
+
+  file.close();
+
+  if (swapped) {
+    uint32_t* words = reinterpret_cast<uint32_t*>(params.get());
+    for (int i = 0; i < NetworkParameterCount; i++) {
+      words[i] = SwapBytes(words[i]);
+    }
+  }
+
+  params_ = std::move(params);
+  Quantize();
+
+  return nullptr;
+}
+
+Score Network::Evaluate(const NetworkAccumulator& accumulator) const {
+  const int32_t output = PropagateKernel(*quantized_, accumulator.GetPlayer(), accumulator.GetOpponent());
+  const int64_t score = static_cast<int64_t>(output) * ScoreScale / OutputScale;
+  return static_cast<Score>(std::max<int64_t>(-64 * ScoreScale, std::min<int64_t>(64 * ScoreScale, score)));
+}
+
+Score Network::Evaluate(const Board& board) const {
+  const Score score = Evaluate(NetworkAccumulator(*this, board));
+  return board.GetNextDisk() == ColorBlack ? score : -score;
+}
+
+void Network::Update(const NetworkGradient& gradient, float learningRate) {
+  if (gradient.GetCount() == 0) {
+    return;
+  }
+
+  const float step = learningRate / static_cast<float>(gradient.GetCount());
+  float* weights = reinterpret_cast<float*>(params_.get());
+  const float* slots = reinterpret_cast<const float*>(&gradient.Get());
+  for (int i = 0; i < NetworkParameterCount; i++) {
+    weights[i] += slots[i] * step;
+  }
+
+  // the float weights are kept in the range of the integer weights
+  const float maxInput = static_cast<float>(MaxInputWeight) / NetworkActivationScale;
+  for (auto& row : params_->inputWeights) {
+    for (float& w : row) {
+      w = std::max(-maxInput, std::min(maxInput, w));
+    }
+  }
+  const float maxHidden = static_cast<float>(MaxHiddenWeight) / NetworkWeightScale;
+  for (auto& row : params_->hiddenWeights) {
+    for (float& w : row) {
+      w = std::max(-maxHidden, std::min(maxHidden, w));
+    }
+  }
+
+  Quantize();
+}
+
+void Network::Quantize() {
+  const NetworkParameters& params = *params_;
+  QuantizedNetwork& q = *quantized_;
+
+  for (int in = 0; in < NetworkInputCount; in++) {
+    for (int i = 0; i < NetworkAccumulatorSize; i++) {
+      const int32_t w = Round(params.inputWeights[in][i] * NetworkActivationScale);
+      q.inputWeights[in][i] = static_cast<int16_t>(std::max(-MaxInputWeight, std::min(MaxInputWeight, w)));
+    }
+  }
+  for (int sq = 0; sq < 64; sq++) {
+    for (int i = 0; i < NetworkAccumulatorSize; i++) {
+      q.flipWeights[sq][i] = static_cast<int16_t>(q.inputWeights[sq][i] - q.inputWeights[64 + sq][i]);
+    }
+  }
+  for (int i = 0; i < NetworkAccumulatorSize; i++) {
+    const int32_t b = Round(params.inputBiases[i] * NetworkActivationScale);
+    q.inputBiases[i] = static_cast<int16_t>(std::max(-MaxInputWeight, std::min(MaxInputWeight, b)));
+  }
+
+  for (int j = 0; j < NetworkHiddenSize; j++) {
+    for (int i = 0; i < NetworkAccumulatorSize * 2; i++) {
+      const int32_t w = Round(params.hiddenWeights[j][i] * NetworkWeightScale);
+      q.hiddenWeights[j][i] = static_cast<int8_t>(std::max(-MaxHiddenWeight, std::min(MaxHiddenWeight, w)));
+    }
+    q.hiddenBiases[j] = Round(params.hiddenBiases[j] * OutputScale);
+    q.outputWeights[j] = Round(params.outputWeights[j] * NetworkWeightScale);
+  }
+  q.outputBias = Round(params.outputBias * OutputScale);
+}
+
+} // namespace beluga
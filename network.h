@@ -0,0 +1,179 @@
+#pragma once
+
+#include "reversi.h"
+#include "evaluate.h"
+#include "aligned.h"
+#include <memory>
+#include <cstdint>
+
+namespace beluga {
+
+// A small neural network evaluator, which is updated efficiently during the search.
+// The inputs are the player discs and the opponent discs of each square from a perspective.
+// The first layer is kept in an accumulator for each perspective, and updated incrementally
+// from the moved square and the flipped discs. The accumulator of the side to move and
+// the other one are concatenated, and pass through clipped ReLU layers to the score.
+constexpr int NetworkInputCount = 128;
+constexpr int NetworkAccumulatorSize = 64;
+constexpr int NetworkHiddenSize = 32;
+
+// The clipped ReLU maps [0, 1] to [0, NetworkActivationScale],
+// and the int8 weights of the hidden layer are multiplied by NetworkWeightScale.
+constexpr int NetworkActivationScale = 127;
+constexpr int NetworkWeightScale = 64;
+
+// The float weights, which are trained and saved.
+// The output is the final disc difference relative to the side to move.
+struct NetworkParameters {
+  float inputWeights[NetworkInputCount][NetworkAccumulatorSize];
+  float inputBiases[NetworkAccumulatorSize];
+  float hiddenWeights[NetworkHiddenSize][NetworkAccumulatorSize * 2];
+  float hiddenBiases[NetworkHiddenSize];
+  float outputWeights[NetworkHiddenSize];
+  float outputBias;
+};
+
+constexpr int NetworkParameterCount = sizeof(NetworkParameters) / sizeof(float);
+
+// The integer weights evaluated by the search, which are allocated by MakeAligned.
+struct QuantizedNetwork {
+  alignas(32) int16_t inputWeights[NetworkInputCount][NetworkAccumulatorSize];
+
+  // the player weight minus the opponent weight of each square, for a flipped disc
+  alignas(32) int16_t flipWeights[64][NetworkAccumulatorSize];
+
+  alignas(32) int16_t inputBiases[NetworkAccumulatorSize];
+  alignas(32) int8_t hiddenWeights[NetworkHiddenSize][NetworkAccumulatorSize * 2];
+  alignas(32) int32_t hiddenBiases[NetworkHiddenSize];
+  alignas(32) int32_t outputWeights[NetworkHiddenSize];
+  int32_t outputBias;
+};
+
+class Network;
+
+// The first layer of both perspectives, which is updated like FeatureIndices
+// and needs no colour either.
+class NetworkAccumulator {
+public:
+
+  NetworkAccumulator() = default;
+  NetworkAccumulator(const Network& network, const PlayerBoard& board);
+  NetworkAccumulator(const Network& network, const Board& board)
+    : NetworkAccumulator(network, PlayerBoard(board)) {}
+
+  // Compares the values with those computed from the board, for the self check.
+  bool Verify(const Network& network, const PlayerBoard& board) const;
+
+  // The player to move places a disc on the square.
+  void DoMove(const Network& network, const Square& square, const Bitboard& mask);
+
+  void UndoMove(const Network& network, const Square& square, const Bitboard& mask);
+
+  void Pass() {
+    player_ ^= 1;
+  }
+
+  // the values from the perspective of the player to move
+  const int16_t* GetPlayer() const {
+    return values_[player_];
+  }
+
+  const int16_t* GetOpponent() const {
+    return values_[player_ ^ 1];
+  }
+
+private:
+
+  // not over-aligned, because NetworkAccumulators are kept in vectors and Trees
+  int16_t values_[2][NetworkAccumulatorSize];
+
+  // the perspective of the player to move
+  int player_;
+
+};
+
+// The sum of the gradients of the squared errors for the float weights.
+class NetworkGradient {
+public:
+
+  NetworkGradient();
+
+  // Adds the gradient which moves the evaluation of the board toward target,
+  // where both are the disc differences relative to black,
+  // and returns target minus the evaluation with the float weights.
+  float Add(const Network& network, const Board& board, float target);
+
+  void Clear();
+
+  int GetCount() const {
+    return count_;
+  }
+
+  const NetworkParameters& Get() const {
+    return *slots_;
+  }
+
+private:
+
+  std::unique_ptr<NetworkParameters> slots_;
+
+  int count_;
+
+};
+
+// The const member functions only read the weights, and many threads can call them
+// at the same time, like Evaluator.
+class Network {
+public:
+
+  static char NetworkParamFileName[];
+
+  Network();
+  Network(const Network&) = delete;
+  Network& operator=(const Network&) = delete;
+  ~Network();
+
+  void InitZero();
+
+  // The small random weights to start the training from.
+  void InitRandom(uint32_t seed);
+
+  const char* SaveParam() const {
+    return SaveParam(NetworkParamFileName);
+  }
+  const char* SaveParam(const char* fileName) const;
+
+  const char* LoadParam() {
+    return LoadParam(NetworkParamFileName);
+  }
+  const char* LoadParam(const char* fileName);
+
+  const NetworkParameters& GetParameters() const {
+    return *params_;
+  }
+
+  const QuantizedNetwork& GetQuantized() const {
+    return *quantized_;
+  }
+
+  // The score relative to the side to move.
+  Score Evaluate(const NetworkAccumulator& accumulator) const;
+
+  // The score relative to black, like Evaluator::Evaluate.
+  Score Evaluate(const Board& board) const;
+
+  // Moves the float weights by the mean of the gradient times learningRate,
+  // and quantizes them again.
+  void Update(const NetworkGradient& gradient, float learningRate);
+
+private:
+
+  void Quantize();
+
+  std::unique_ptr<NetworkParameters> params_;
+
+  AlignedPtr<QuantizedNetwork> quantized_;
+
+};
+
+} // namespace beluga
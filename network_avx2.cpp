@@ -0,0 +1,80 @@
+#include "network.h"
+
+#if defined(__x86_64__) || defined(_M_X64)
+
+#include <immintrin.h>
+
+namespace {
+
+// the clipped values of 32 accumulator entries as uint8 in the same order,
+// where the weights are aligned but the accumulator is not
+inline __m256i ClipPack(const int16_t* values) {
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i max = _mm256_set1_epi16(beluga::NetworkActivationScale);
+  __m256i a = _mm256_min_epi16(_mm256_max_epi16(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(values)), zero), max);
+  __m256i b = _mm256_min_epi16(_mm256_max_epi16(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(values + 16)), zero), max);
+  // packus interleaves the 128-bit lanes of a and b
+  return _mm256_permute4x64_epi64(_mm256_packus_epi16(a, b), _MM_SHUFFLE(3, 1, 2, 0));
+}
+
+// the 8 horizontal sums of s[0..8)
+inline __m256i ReduceAdd8(const __m256i* s) {
+  __m256i t0 = _mm256_hadd_epi32(_mm256_hadd_epi32(s[0], s[1]), _mm256_hadd_epi32(s[2], s[3]));
+  __m256i t1 = _mm256_hadd_epi32(_mm256_hadd_epi32(s[4], s[5]), _mm256_hadd_epi32(s[6], s[7]));
+  return _mm256_add_epi32(_mm256_permute2x128_si256(t0, t1, 0x20), _mm256_permute2x128_si256(t0, t1, 0x31));
+}
+
+inline int ReduceAdd(__m256i x) {
+  __m128i y = _mm_add_epi32(_mm256_castsi256_si128(x), _mm256_extracti128_si256(x, 1));
+  y = _mm_add_epi32(y, _mm_shuffle_epi32(y, _MM_SHUFFLE(1, 0, 3, 2)));
+  y = _mm_add_epi32(y, _mm_shuffle_epi32(y, _MM_SHUFFLE(2, 3, 0, 1)));
+  return _mm_cvtsi128_si32(y);
+}
+
+} // namespace
+
+namespace beluga {
+
+namespace avx2 {
+
+static_assert(NetworkAccumulatorSize % 32 == 0 && NetworkHiddenSize % 8 == 0,
+              "the kernel handles 32 inputs and 8 hidden units at once");
+static_assert(NetworkWeightScale == 1 << 6, "the hidden sums are shifted by log2(NetworkWeightScale)");
+
+int32_t Propagate(const QuantizedNetwork& weights, const int16_t* player, const int16_t* opponent) {
+  constexpr int InputVectors = NetworkAccumulatorSize * 2 / 32;
+  __m256i inputs[InputVectors];
+  for (int k = 0; k < InputVectors / 2; k++) {
+    inputs[k] = ClipPack(player + k * 32);
+    inputs[InputVectors / 2 + k] = ClipPack(opponent + k * 32);
+  }
+
+  // maddubs never saturates, because 2 * 127 * 127 fits in int16
+  const __m256i ones = _mm256_set1_epi16(1);
+  const __m256i max = _mm256_set1_epi32(NetworkActivationScale);
+  __m256i output = _mm256_setzero_si256();
+  for (int j = 0; j < NetworkHiddenSize; j += 8) {
+    __m256i sums[8];
+    for (int u = 0; u < 8; u++) {
+      const __m256i* w = reinterpret_cast<const __m256i*>(weights.hiddenWeights[j + u]);
+      __m256i sum = _mm256_setzero_si256();
+      for (int k = 0; k < InputVectors; k++) {
+        sum = _mm256_add_epi32(sum, _mm256_madd_epi16(_mm256_maddubs_epi16(inputs[k], _mm256_load_si256(w + k)), ones));
+      }
+      sums[u] = sum;
+    }
+
+    __m256i hidden = _mm256_add_epi32(ReduceAdd8(sums), _mm256_load_si256(reinterpret_cast<const __m256i*>(weights.hiddenBiases + j)));
+    hidden = _mm256_srai_epi32(hidden, 6);
+    hidden = _mm256_min_epi32(_mm256_max_epi32(hidden, _mm256_setzero_si256()), max);
+    output = _mm256_add_epi32(output, _mm256_mullo_epi32(hidden, _mm256_load_si256(reinterpret_cast<const __m256i*>(weights.outputWeights + j))));
+  }
+
+  return weights.outputBias + ReduceAdd(output);
+}
+
+} // namespace avx2
+
+} // namespace beluga
+
+#endif
@@ -0,0 +1,146 @@
+#pragma once
+
+#include "reversi.h"
+#include <cstdint>
+
+namespace beluga {
+
+// The pattern features are defined only by PatternDefinitions.
+// The layout of the weights, the squares of each feature and the reference extraction
+// are derived from it at compile time, and evaluate.cpp builds the extraction tables,
+// the incremental deltas and the symmetry of the weights from them.
+// A new pattern needs no other change, but the magic multipliers in evaluate.cpp
+// are searched at startup until they are added to FeatureMagics.
+
+constexpr int MaxPatternLength = 10;
+
+// A pattern is a weight table shared by its instances, which are the images of the squares
+// under the symmetries of the board. The first square has the lowest ternary digit.
+struct PatternDefinition {
+  const char* name;
+  int length;
+  int8_t squares[MaxPatternLength];
+  int instanceCount;
+  int8_t symmetries[SymmetryCount]; // the symmetry of each instance (see Bitboard::Transform)
+};
+
+constexpr PatternDefinition PatternDefinitions[] = {
+  { "Edge", 10, { 011, 000, 001, 002, 003, 004, 005, 006, 007, 016 },
+    4, { SymmetryIdentity, SymmetryVertical, SymmetryDiagonal, SymmetryVertical | SymmetryDiagonal } },
+  { "Hor2", 8, { 010, 011, 012, 013, 014, 015, 016, 017 },
+    4, { SymmetryIdentity, SymmetryVertical, SymmetryDiagonal, SymmetryVertical | SymmetryDiagonal } },
+  { "Hor3", 8, { 020, 021, 022, 023, 024, 025, 026, 027 },
+    4, { SymmetryIdentity, SymmetryVertical, SymmetryDiagonal, SymmetryVertical | SymmetryDiagonal } },
+  { "Hor4", 8, { 030, 031, 032, 033, 034, 035, 036, 037 },
+    4, { SymmetryIdentity, SymmetryVertical, SymmetryDiagonal, SymmetryVertical | SymmetryDiagonal } },
+  { "Diag8", 8, { 000, 011, 022, 033, 044, 055, 066, 077 },
+    2, { SymmetryIdentity, SymmetryVertical } },
+  { "Diag7", 7, { 001, 012, 023, 034, 045, 056, 067 },
+    4, { SymmetryIdentity, SymmetryDiagonal, SymmetryVertical, SymmetryHorizontal | SymmetryDiagonal } },
+  { "Diag6", 6, { 002, 013, 024, 035, 046, 057 },
+    4, { SymmetryIdentity, SymmetryDiagonal, SymmetryVertical, SymmetryHorizontal | SymmetryDiagonal } },
+  { "Diag5", 5, { 003, 014, 025, 036, 047 },
+    4, { SymmetryIdentity, SymmetryDiagonal, SymmetryVertical, SymmetryHorizontal | SymmetryDiagonal } },
+  { "Diag4", 4, { 004, 015, 026, 037 },
+    4, { SymmetryIdentity, SymmetryDiagonal, SymmetryVertical, SymmetryHorizontal | SymmetryDiagonal } },
+  { "Corner3x3", 9, { 000, 001, 002,
+                      010, 011, 012,
+                      020, 021, 022 },
+    4, { SymmetryIdentity, SymmetryHorizontal, SymmetryVertical, SymmetryVertical | SymmetryHorizontal } },
+  { "Corner5x2", 10, { 000, 001, 002, 003, 004,
+                       010, 011, 012, 013, 014 },
+    8, { SymmetryIdentity, SymmetryHorizontal, SymmetryVertical, SymmetryVertical | SymmetryHorizontal,
+         SymmetryDiagonal, SymmetryHorizontal | SymmetryDiagonal,
+         SymmetryVertical | SymmetryDiagonal, SymmetryVertical | SymmetryHorizontal | SymmetryDiagonal } },
+};
+
+constexpr int PatternCount = sizeof(PatternDefinitions) / sizeof(PatternDefinitions[0]);
+
+constexpr int Pow3(int n) {
+  return n == 0 ? 1 : Pow3(n - 1) * 3;
+}
+
+// the number of weights of the pattern
+constexpr int GetPatternSize(int pattern) {
+  return Pow3(PatternDefinitions[pattern].length);
+}
+
+// the offset of the weight table of the pattern, where the tables are in the order of PatternDefinitions
+constexpr int GetPatternOffset(int pattern) {
+  return pattern == 0 ? 0 : GetPatternOffset(pattern - 1) + GetPatternSize(pattern - 1);
+}
+
+constexpr int PatternWeightCount = GetPatternOffset(PatternCount);
+
+// the first feature of the pattern, where the features are the instances in the order of PatternDefinitions
+constexpr int GetFirstFeature(int pattern) {
+  return pattern == 0 ? 0 : GetFirstFeature(pattern - 1) + PatternDefinitions[pattern - 1].instanceCount;
+}
+
+constexpr int FeatureCount = GetFirstFeature(PatternCount);
+
+constexpr int GetFeaturePattern(int feature, int pattern = 0) {
+  return feature < GetFirstFeature(pattern + 1) ? pattern : GetFeaturePattern(feature, pattern + 1);
+}
+
+constexpr int FlipSquare(int square, int symmetry) {
+  return square ^ ((symmetry & SymmetryVertical) ? 070 : 0) ^ ((symmetry & SymmetryHorizontal) ? 007 : 0);
+}
+
+// the same transform as Bitboard::Transform
+constexpr int TransformSquare(int square, int symmetry) {
+  return (symmetry & SymmetryDiagonal)
+       ? (FlipSquare(square, symmetry) & 7) * 8 + (FlipSquare(square, symmetry) >> 3)
+       : FlipSquare(square, symmetry);
+}
+
+constexpr int GetFeatureLength(int feature) {
+  return PatternDefinitions[GetFeaturePattern(feature)].length;
+}
+
+// the square of the digit of the feature
+constexpr int GetFeatureSquare(int feature, int digit) {
+  return TransformSquare(
+    PatternDefinitions[GetFeaturePattern(feature)].squares[digit],
+    PatternDefinitions[GetFeaturePattern(feature)].symmetries[feature - GetFirstFeature(GetFeaturePattern(feature))]);
+}
+
+constexpr int CountInstanceSquare(int pattern, int instance, int square, int digit = 0) {
+  return digit == PatternDefinitions[pattern].length ? 0
+       : (TransformSquare(PatternDefinitions[pattern].squares[digit], PatternDefinitions[pattern].symmetries[instance]) == square ? 1 : 0)
+         + CountInstanceSquare(pattern, instance, square, digit + 1);
+}
+
+constexpr int CountPatternSquare(int pattern, int square, int instance = 0) {
+  return instance == PatternDefinitions[pattern].instanceCount ? 0
+       : CountInstanceSquare(pattern, instance, square) + CountPatternSquare(pattern, square, instance + 1);
+}
+
+// the number of features which include the square
+constexpr int GetSquareFeatureCount(int square, int pattern = 0) {
+  return pattern == PatternCount ? 0 : CountPatternSquare(pattern, square) + GetSquareFeatureCount(square, pattern + 1);
+}
+
+constexpr int MaxOf(int a, int b) {
+  return a > b ? a : b;
+}
+
+constexpr int GetMaxSquareFeatureCount(int square = 0) {
+  return square == 64 ? 0 : MaxOf(GetSquareFeatureCount(square), GetMaxSquareFeatureCount(square + 1));
+}
+
+// the size of the incremental update table of each square
+constexpr int MaxSquareFeatureCount = GetMaxSquareFeatureCount();
+
+constexpr bool IsValidPattern(int pattern = 0) {
+  return pattern == PatternCount
+      || (PatternDefinitions[pattern].length > 0
+       && PatternDefinitions[pattern].length <= MaxPatternLength
+       && PatternDefinitions[pattern].instanceCount > 0
+       && PatternDefinitions[pattern].instanceCount <= SymmetryCount
+       && IsValidPattern(pattern + 1));
+}
+
+static_assert(IsValidPattern(), "a pattern has an invalid length or instance count");
+
+} // namespace beluga
@@ -0,0 +1,171 @@
+#include "reversi.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <iomanip>
+#include <thread>
+#include <vector>
+
+using namespace beluga;
+
+namespace {
+
+// The known numbers of leaf nodes from the normal initial board.
+// A pass is counted as a ply, and a finished game is a leaf.
+const uint64_t KnownCounts[] = {
+  1llu,
+  4llu,
+  12llu,
+  56llu,
+  244llu,
+  1396llu,
+  8200llu,
+  55092llu,
+  390216llu,
+  3005288llu,
+  24571284llu,
+  212258800llu,
+  1939886636llu,
+  18429641748llu,
+  184042084512llu,
+};
+
+constexpr int KnownMaxDepth = sizeof(KnownCounts) / sizeof(KnownCounts[0]) - 1;
+
+struct Task {
+  PlayerBoard board;
+  int depth;
+  bool passed;
+};
+
+uint64_t Perft(PlayerBoard& board, int depth, bool passed) {
+  if (depth == 0) {
+    return 1;
+  }
+
+  Bitboard moves = board.GenerateMoves();
+
+  // pass
+  if (moves == Bitboard(0)) {
+    if (passed) {
+      return 1;
+    }
+
+    board.Pass();
+    uint64_t nodes = Perft(board, depth - 1, true);
+    board.Pass();
+    return nodes;
+  }
+
+  if (depth == 1) {
+    return moves.Count();
+  }
+
+  uint64_t nodes = 0;
+  for (Square move : moves) {
+    Bitboard mask = board.DoMove(move);
+    nodes += Perft(board, depth - 1, false);
+    board.UndoMove(move, mask);
+  }
+  return nodes;
+}
+
+// Splits the tree near the root into tasks for the worker threads,
+// and returns the number of leaves found above the split depth.
+uint64_t Split(PlayerBoard& board, int depth, bool passed, int splitDepth, std::vector<Task>& tasks) {
+  if (depth == 0 || splitDepth == 0) {
+    tasks.push_back({ board, depth, passed });
+    return 0;
+  }
+
+  Bitboard moves = board.GenerateMoves();
+
+  // pass
+  if (moves == Bitboard(0)) {
+    if (passed) {
+      return 1;
+    }
+
+    board.Pass();
+    uint64_t nodes = Split(board, depth - 1, true, splitDepth - 1, tasks);
+    board.Pass();
+    return nodes;
+  }
+
+  uint64_t nodes = 0;
+  for (Square move : moves) {
+    Bitboard mask = board.DoMove(move);
+    nodes += Split(board, depth - 1, false, splitDepth - 1, tasks);
+    board.UndoMove(move, mask);
+  }
+  return nodes;
+}
+
+uint64_t ParallelPerft(const PlayerBoard& root, int depth, int threadCount) {
+  if (threadCount <= 1) {
+    PlayerBoard board = root;
+    return Perft(board, depth, false);
+  }
+
+  std::vector<Task> tasks;
+  PlayerBoard board = root;
+  std::atomic<uint64_t> nodes(Split(board, depth, false, 3, tasks));
+  std::atomic<size_t> next(0);
+
+  std::vector<std::thread> threads;
+  for (int i = 0; i < threadCount; i++) {
+    threads.emplace_back([&tasks, &nodes, &next]() {
+      uint64_t sum = 0;
+      for (size_t ti = next++; ti < tasks.size(); ti = next++) {
+        Task& task = tasks[ti];
+        sum += Perft(task.board, task.depth, task.passed);
+      }
+      nodes += sum;
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  return nodes.load();
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+  int maxDepth = argc >= 2 ? std::atoi(argv[1]) : 11;
+  int threadCount = argc >= 3 ? std::atoi(argv[2]) : 1;
+  if (maxDepth < 1 || threadCount < 1) {
+    std::cerr << "usage: perft [depth] [threads]" << std::endl;
+    return 1;
+  }
+
+  std::cout << "depth  : " << maxDepth << std::endl;
+  std::cout << "threads: " << threadCount << std::endl;
+
+  const PlayerBoard root(Board::GetNormalInitBoard());
+  bool ok = true;
+  for (int depth = 1; depth <= maxDepth; depth++) {
+    auto start = std::chrono::steady_clock::now();
+    uint64_t nodes = ParallelPerft(root, depth, threadCount);
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << std::setw(2) << depth << ": "
+              << std::setw(16) << nodes << " nodes "
+              << std::setw(10) << std::fixed << std::setprecision(3) << elapsed << " sec "
+              << std::setw(10) << std::setprecision(2) << (elapsed > 0.0 ? nodes / elapsed * 1e-6 : 0.0) << " Mnps";
+    if (depth <= KnownMaxDepth) {
+      if (nodes == KnownCounts[depth]) {
+        std::cout << " OK";
+      } else {
+        std::cout << " NG (expected " << KnownCounts[depth] << ")";
+        ok = false;
+      }
+    }
+    std::cout << std::endl;
+  }
+
+  return ok ? 0 : 1;
+}
@@ -1,8 +1,38 @@
 #include "reversi.h"
 #include "zobrist.h"
+#include "cpu.h"
 
 namespace beluga {
 
+#if BELUGA_AVX2
+namespace avx2 {
+
+// defined in reversi_avx2.cpp
+Bitboard GenerateMoves(const Bitboard& player, const Bitboard& opponent);
+Bitboard GetFlipMask(const Square& square, const Bitboard& player, const Bitboard& opponent);
+
+} // namespace avx2
+#endif
+
+template <int shift>
+inline Bitboard Shift(const Bitboard& bb) {
+  return shift > 0 ? Bitboard(bb.GetRaw() << (shift & 63))
+                   : Bitboard(bb.GetRaw() >> (-shift & 63));
+}
+
+// Kogge-Stone occluded fill.
+// gen is extended along the direction through the squares of pro.
+// Runs of up to 7 squares are filled in 3 steps without any branches.
+template <int shift>
+inline Bitboard FloodFill(Bitboard gen, Bitboard pro) {
+  gen |= pro & Shift<shift>(gen);
+  pro &= Shift<shift>(pro);
+  gen |= pro & Shift<shift * 2>(gen);
+  pro &= Shift<shift * 2>(pro);
+  gen |= pro & Shift<shift * 4>(gen);
+  return gen;
+}
+
 const int DirDelta[8] = {
   /* LeftUp    */ -9,
   /* Up        */ -8,
@@ -90,120 +120,294 @@ const bool DirWall[8][64] = {
   },
 };
 
-const char* SquareStrings[64] = {
-  "a1", "b1", "c1", "d1", "e1", "f1", "g1", "h1",
-  "a2", "b2", "c2", "d2", "e2", "f2", "g2", "h2",
-  "a3", "b3", "c3", "d3", "e3", "f3", "g3", "h3",
-  "a4", "b4", "c4", "d4", "e4", "f4", "g4", "h4",
-  "a5", "b5", "c5", "d5", "e5", "f5", "g5", "h5",
-  "a6", "b6", "c6", "d6", "e6", "f6", "g6", "h6",
-  "a7", "b7", "c7", "d7", "e7", "f7", "g7", "h7",
-  "a8", "b8", "c8", "d8", "e8", "f8", "g8", "h8",
-};
+namespace {
 
-bool Board::CanMove(const Square& square) const {
-  if (Get(square) != ColorNone) {
-    return false;
-  }
+constexpr uint64_t MaskFile1 = 0x0101010101010101llu;
 
-  return CanMove(square, nextDisk_);
-}
+struct FlipTables {
+  // [position][opponent discs on positions 1 to 6] => the squares at which
+  // a player's disc outflanks the run adjacent to the position
+  uint8_t outflank[8][64];
 
-bool Board::CanMove(const Square& square, DiskColor color) const {
-  if (color == ColorBlack) {
-    for (int di = 0; di < 8; di++) {
-      Direction dir = (Direction)di;
-      bool reversible = false;
+  // [position][outflanking player's discs] => the discs to be flipped
+  uint8_t flip[8][256];
 
-      if (square.IsWall(dir)) {
-        continue;
-      }
+  // [position][player's discs] => the number of discs flipped
+  // when all the other squares are the opponent's
+  uint8_t lastFlipCount[8][256];
 
-      for (Square sq = square.Dir(dir); ; sq = sq.Dir(dir)) {
-        if (white_.Get(sq)) {
-          reversible = true;
-        } else if (reversible && black_.Get(sq)) {
-          return true;
-        } else {
-          break;
+  uint64_t diagMask[64];
+  uint64_t antiDiagMask[64];
+
+  FlipTables() {
+    for (int pos = 0; pos < 8; pos++) {
+      for (int o6 = 0; o6 < 64; o6++) {
+        int o = o6 << 1;
+        int i = pos - 1;
+        while (i > 0 && (o & (1 << i))) {
+          i--;
+        }
+        int j = pos + 1;
+        while (j < 7 && (o & (1 << j))) {
+          j++;
         }
+        outflank[pos][o6] = static_cast<uint8_t>(
+            (i >= 0 && i < pos - 1 ? 1 << i : 0) | (j <= 7 && j > pos + 1 ? 1 << j : 0));
+      }
 
-        if (sq.IsWall(dir)) {
-          break;
+      for (int of = 0; of < 256; of++) {
+        int f = 0;
+        for (int i = pos - 1; i >= 0; i--) {
+          if (of & (1 << i)) {
+            f |= ((1 << pos) - 1) & ~((2 << i) - 1);
+            break;
+          }
         }
+        for (int j = pos + 1; j < 8; j++) {
+          if (of & (1 << j)) {
+            f |= ((1 << j) - 1) & ~((2 << pos) - 1);
+            break;
+          }
+        }
+        flip[pos][of] = static_cast<uint8_t>(f);
       }
     }
-  } else {
-    for (int di = 0; di < 8; di++) {
-      Direction dir = (Direction)di;
-      bool reversible = false;
 
-      if (square.IsWall(dir)) {
-        continue;
+    for (int pos = 0; pos < 8; pos++) {
+      for (int p = 0; p < 256; p++) {
+        int o = ~p & ~(1 << pos) & 0xff;
+        int f = flip[pos][outflank[pos][(o >> 1) & 0x3f] & p];
+        lastFlipCount[pos][p] = static_cast<uint8_t>(PopCount(f));
       }
+    }
 
-      for (Square sq = square.Dir(dir); ; sq = sq.Dir(dir)) {
-        if (black_.Get(sq)) {
-          reversible = true;
-        } else if (reversible && white_.Get(sq)) {
-          return true;
-        } else {
-          break;
+    for (int sq = 0; sq < 64; sq++) {
+      int x = sq % 8;
+      int y = sq / 8;
+      diagMask[sq] = 0;
+      antiDiagMask[sq] = 0;
+      for (int i = 0; i < 8; i++) {
+        if (y - x + i >= 0 && y - x + i < 8) {
+          diagMask[sq] |= 1llu << ((y - x + i) * 8 + i);
         }
-
-        if (sq.IsWall(dir)) {
-          break;
+        if (y + x - i >= 0 && y + x - i < 8) {
+          antiDiagMask[sq] |= 1llu << ((y + x - i) * 8 + i);
         }
       }
     }
   }
-  return false;
-}
+};
 
-Bitboard Board::DoMove(const Square& square) {
-  Bitboard mask(0);
-  for (int di = 0; di < 8; di++) {
-    Direction dir = (Direction)di;
-    Bitboard m(0);
+const FlipTables flipTables;
 
-    if (square.IsWall(dir)) {
+const uint8_t (&OutflankTable)[8][64] = flipTables.outflank;
+const uint8_t (&FlipTable)[8][256] = flipTables.flip;
+const uint8_t (&LastFlipCount)[8][256] = flipTables.lastFlipCount;
+const uint64_t (&DiagMask)[64] = flipTables.diagMask;
+const uint64_t (&AntiDiagMask)[64] = flipTables.antiDiagMask;
+
+// Returns the player's discs on an edge which can not be flipped by any
+// sequence of moves on the edge. Moves are not required to be legal,
+// so the result is a conservative estimate.
+int FindEdgeStable(int player, int opponent, int stable) {
+  stable &= player;
+  int empty = ~(player | opponent) & 0xff;
+  if (stable == 0 || empty == 0) {
+    return stable;
+  }
+
+  for (int x = 0; x < 8; x++) {
+    if ((empty & (1 << x)) == 0) {
       continue;
     }
 
-    for (Square sq = square.Dir(dir); ; sq = sq.Dir(dir)) {
-      if (nextDisk_ == ColorBlack) {
-        if (white_.Get(sq)) {
-          m.Set(sq);
-        } else {
-          if (black_.Get(sq)) {
-            Reverse(m);
-            mask |= m;
-          }
-          break;
-        }
+    int f = FlipTable[x][OutflankTable[x][(opponent >> 1) & 0x3f] & player];
+    stable = FindEdgeStable(player | f | (1 << x), opponent ^ f, stable);
+    if (stable == 0) {
+      return stable;
+    }
 
-      } else {
-        if (black_.Get(sq)) {
-          m.Set(sq);
-        } else {
-          if (white_.Get(sq)) {
-            Reverse(m);
-            mask |= m;
-          }
-          break;
+    f = FlipTable[x][OutflankTable[x][(player >> 1) & 0x3f] & opponent];
+    stable = FindEdgeStable(player ^ f, opponent | f | (1 << x), stable);
+    if (stable == 0) {
+      return stable;
+    }
+  }
+
+  return stable;
+}
+
+struct StabilityTables {
+  // [ternary index of an edge] => the player's stable discs
+  uint8_t edge[6561];
+
+  // [8 bits] => ternary index
+  uint16_t ternary[256];
+
+  // [8 bits] => the bits on the column A
+  uint64_t column[256];
+
+  // all diagonal lines of both directions
+  uint64_t diagonals[30];
+
+  StabilityTables() {
+    for (int bits = 0; bits < 256; bits++) {
+      ternary[bits] = 0;
+      column[bits] = 0;
+      for (int i = 7; i >= 0; i--) {
+        ternary[bits] = static_cast<uint16_t>(ternary[bits] * 3 + ((bits >> i) & 1));
+        if (bits & (1 << i)) {
+          column[bits] |= 1llu << (i * 8);
         }
       }
+    }
 
-      if (sq.IsWall(dir)) {
-        break;
+    for (int player = 0; player < 256; player++) {
+      for (int opponent = 0; opponent < 256; opponent++) {
+        if ((player & opponent) == 0) {
+          edge[ternary[player] + 2 * ternary[opponent]] =
+              static_cast<uint8_t>(FindEdgeStable(player, opponent, player));
+        }
       }
     }
+
+    for (int i = 0; i < 15; i++) {
+      Square square = i < 8 ? Square(i, 0) : Square(0, i - 7);
+      diagonals[i] = DiagMask[square.GetRaw()];
+      square = i < 8 ? Square(i, 0) : Square(7, i - 7);
+      diagonals[i + 15] = AntiDiagMask[square.GetRaw()];
+    }
+  }
+};
+
+const StabilityTables stabilityTables;
+
+Bitboard GenerateMovesPortable(const Bitboard& player, const Bitboard& opponent) {
+  // horizontal and diagonal runs must not wrap around the board edge
+  Bitboard inner = opponent & Bitboard::MaskCol1to7() & Bitboard::MaskCol2to8();
+  Bitboard empty = ~(player | opponent);
+  Bitboard moves = (FloodFill<-9>(player, inner) ^ player).LeftUp()
+                 | (FloodFill<-8>(player, opponent) ^ player).Up()
+                 | (FloodFill<-7>(player, inner) ^ player).RightUp()
+                 | (FloodFill<-1>(player, inner) ^ player).Left()
+                 | (FloodFill< 1>(player, inner) ^ player).Right()
+                 | (FloodFill< 7>(player, inner) ^ player).LeftDown()
+                 | (FloodFill< 8>(player, opponent) ^ player).Down()
+                 | (FloodFill< 9>(player, inner) ^ player).RightDown();
+  return moves & empty;
+}
+
+Bitboard GetFlipMaskPortable(const Square& square, const Bitboard& player, const Bitboard& opponent) {
+  const int x = square.GetX();
+  const int y = square.GetY();
+  const uint64_t p = player.GetRaw();
+  const uint64_t o = opponent.GetRaw();
+  uint64_t mask;
+
+  // horizontal line: indexed by x
+  {
+    uint64_t pl = (p >> (y * 8)) & 0xff;
+    uint64_t ol = (o >> (y * 8)) & 0xff;
+    uint64_t f = FlipTable[x][OutflankTable[x][(ol >> 1) & 0x3f] & pl];
+    mask = f << (y * 8);
+  }
+
+  // vertical line: indexed by y
+  {
+    uint64_t pl = (((p >> x) & MaskFile1) * 0x0102040810204080llu) >> 56;
+    uint64_t ol = (((o >> x) & MaskFile1) * 0x0102040810204080llu) >> 56;
+    uint64_t f = FlipTable[y][OutflankTable[y][(ol >> 1) & 0x3f] & pl];
+    mask |= ((f * 0x0002040810204081llu) & MaskFile1) << x;
+  }
+
+  // diagonal lines: each square on a diagonal has its own column, so the line is indexed by x
+  {
+    uint64_t dm = DiagMask[square.GetRaw()];
+    uint64_t pl = ((p & dm) * 0x0101010101010101llu) >> 56;
+    uint64_t ol = ((o & dm) * 0x0101010101010101llu) >> 56;
+    uint64_t f = FlipTable[x][OutflankTable[x][(ol >> 1) & 0x3f] & pl];
+    mask |= (f * 0x0101010101010101llu) & dm;
   }
+  {
+    uint64_t dm = AntiDiagMask[square.GetRaw()];
+    uint64_t pl = ((p & dm) * 0x0101010101010101llu) >> 56;
+    uint64_t ol = ((o & dm) * 0x0101010101010101llu) >> 56;
+    uint64_t f = FlipTable[x][OutflankTable[x][(ol >> 1) & 0x3f] & pl];
+    mask |= (f * 0x0101010101010101llu) & dm;
+  }
+
+  return Bitboard(mask);
+}
+
+uint64_t GetZobristHash(const Bitboard& player, const Bitboard& opponent) {
+  uint64_t hash = 0;
+  for (Square square : player) {
+    hash ^= ZobristPlayerTable[square.GetRaw()];
+  }
+  for (Square square : opponent) {
+    hash ^= ZobristOpponentTable[square.GetRaw()];
+  }
+  return hash;
+}
+
+bool IsLessThan(const Bitboard& first1, const Bitboard& second1,
+                const Bitboard& first2, const Bitboard& second2) {
+  return first1.GetRaw() < first2.GetRaw()
+      || (first1 == first2 && second1.GetRaw() < second2.GetRaw());
+}
+
+using GenerateMovesFunc = Bitboard (*)(const Bitboard& player, const Bitboard& opponent);
+using GetFlipMaskFunc = Bitboard (*)(const Square& square, const Bitboard& player, const Bitboard& opponent);
 
+// The portable kernels are set before any dynamic initialization,
+// and replaced by the best ones for the running CPU.
+GenerateMovesFunc GenerateMovesKernel = GenerateMovesPortable;
+GetFlipMaskFunc GetFlipMaskKernel = GetFlipMaskPortable;
+
+struct KernelSelector {
+  KernelSelector() {
+#if BELUGA_AVX2
+    if (GetCpuFeatures().avx2) {
+      GenerateMovesKernel = avx2::GenerateMoves;
+      GetFlipMaskKernel = avx2::GetFlipMask;
+    }
+#endif
+  }
+} kernelSelector;
+
+} // namespace
+
+const char* SquareStrings[64] = {
+  "a1", "b1", "c1", "d1", "e1", "f1", "g1", "h1",
+  "a2", "b2", "c2", "d2", "e2", "f2", "g2", "h2",
+  "a3", "b3", "c3", "d3", "e3", "f3", "g3", "h3",
+  "a4", "b4", "c4", "d4", "e4", "f4", "g4", "h4",
+  "a5", "b5", "c5", "d5", "e5", "f5", "g5", "h5",
+  "a6", "b6", "c6", "d6", "e6", "f6", "g6", "h6",
+  "a7", "b7", "c7", "d7", "e7", "f7", "g7", "h7",
+  "a8", "b8", "c8", "d8", "e8", "f8", "g8", "h8",
+};
+
+bool Board::CanMove(const Square& square) const {
+  if (Get(square) != ColorNone) {
+    return false;
+  }
+
+  return nextDisk_ == ColorBlack
+       ? GetFlipMask(square, black_, white_) != Bitboard(0)
+       : GetFlipMask(square, white_, black_) != Bitboard(0);
+}
+
+Bitboard Board::DoMove(const Square& square) {
+  Bitboard mask;
   if (nextDisk_ == ColorBlack) {
+    mask = GetFlipMask(square, black_, white_);
+    Reverse(mask);
     black_.Set(square);
     nextDisk_ = ColorWhite;
   } else {
+    mask = GetFlipMask(square, white_, black_);
+    Reverse(mask);
     white_.Set(square);
     nextDisk_ = ColorBlack;
   }
@@ -223,29 +427,12 @@ void Board::UndoMove(const Square& square, const Bitboard& mask) {
 }
 
 bool Board::IsEnd() const {
-  Bitboard open = GetOpenSquares(ColorWhite);
-  for (Square square = open.Pick(); !square.IsInvalid(); square = open.Pick()) {
-    if (CanMove(square, ColorBlack)) {
-      return false;
-    }
-  }
-  open = GetOpenSquares(ColorBlack);
-  for (Square square = open.Pick(); !square.IsInvalid(); square = open.Pick()) {
-    if (CanMove(square, ColorWhite)) {
-      return false;
-    }
-  }
-  return true;
+  return GenerateMoves(black_, white_) == Bitboard(0)
+      && GenerateMoves(white_, black_) == Bitboard(0);
 }
 
 bool Board::MustPass() const {
-  Bitboard open = GetOpenSquares(nextDisk_ == ColorBlack ? ColorWhite : ColorBlack);
-  for (Square square = open.Pick(); !square.IsInvalid(); square = open.Pick()) {
-    if (CanMove(square, nextDisk_)) {
-      return false;
-    }
-  }
-  return true;
+  return GenerateMoves() == Bitboard(0);
 }
 
 void Board::Pass() {
@@ -257,25 +444,112 @@ Bitboard Board::GenerateMoves() const {
 }
 
 Bitboard Board::GenerateMoves(DiskColor color) const {
-  Bitboard moves = Bitboard(0);
-  Bitboard open = GetOpenSquares(color == ColorBlack ? ColorWhite : ColorBlack);
-  for (Square square = open.Pick(); !square.IsInvalid(); square = open.Pick()) {
-    if (CanMove(square, color)) {
-      moves.Set(square);
+  return color == ColorBlack
+       ? GenerateMoves(black_, white_)
+       : GenerateMoves(white_, black_);
+}
+
+Bitboard Board::GenerateMoves(const Bitboard& player, const Bitboard& opponent) {
+  return GenerateMovesKernel(player, opponent);
+}
+
+Bitboard Board::GetFlipMask(const Square& square, const Bitboard& player, const Bitboard& opponent) {
+  return GetFlipMaskKernel(square, player, opponent);
+}
+
+int Board::CountLastFlips(const Square& square, const Bitboard& player) {
+  const int x = square.GetX();
+  const int y = square.GetY();
+  const uint64_t p = player.GetRaw();
+
+  int count = LastFlipCount[x][(p >> (y * 8)) & 0xff];
+  count += LastFlipCount[y][(((p >> x) & MaskFile1) * 0x0102040810204080llu) >> 56];
+  count += LastFlipCount[x][((p & DiagMask[square.GetRaw()]) * 0x0101010101010101llu) >> 56];
+  count += LastFlipCount[x][((p & AntiDiagMask[square.GetRaw()]) * 0x0101010101010101llu) >> 56];
+  return count;
+}
+
+Bitboard Board::GetStableDisks(DiskColor color) const {
+  return color == ColorBlack
+       ? GetStableDisks(black_, white_)
+       : GetStableDisks(white_, black_);
+}
+
+Bitboard Board::GetFrontierDisks(DiskColor color) const {
+  return color == ColorBlack
+       ? GetFrontierDisks(black_, white_)
+       : GetFrontierDisks(white_, black_);
+}
+
+Bitboard Board::GetPotentialMoves(DiskColor color) const {
+  return color == ColorBlack
+       ? GetPotentialMoves(black_, white_)
+       : GetPotentialMoves(white_, black_);
+}
+
+Bitboard Board::GetStableDisks(const Bitboard& player, const Bitboard& opponent) {
+  const uint64_t p = player.GetRaw();
+  const uint64_t o = opponent.GetRaw();
+  const uint64_t occupied = p | o;
+  const uint8_t* edge = stabilityTables.edge;
+  const uint16_t* ternary = stabilityTables.ternary;
+  const uint64_t* column = stabilityTables.column;
+
+  // discs on the edges
+  uint64_t stable = 0;
+  stable |= static_cast<uint64_t>(edge[ternary[p & 0xff] + 2 * ternary[o & 0xff]]);
+  stable |= static_cast<uint64_t>(edge[ternary[p >> 56] + 2 * ternary[o >> 56]]) << 56;
+  uint64_t pa = ((p & MaskFile1) * 0x0102040810204080llu) >> 56;
+  uint64_t oa = ((o & MaskFile1) * 0x0102040810204080llu) >> 56;
+  stable |= column[edge[ternary[pa] + 2 * ternary[oa]]];
+  uint64_t ph = (((p >> 7) & MaskFile1) * 0x0102040810204080llu) >> 56;
+  uint64_t oh = (((o >> 7) & MaskFile1) * 0x0102040810204080llu) >> 56;
+  stable |= column[edge[ternary[ph] + 2 * ternary[oh]]] << 7;
+
+  // full lines
+  uint64_t fullH = occupied & (occupied >> 4);
+  fullH &= fullH >> 2;
+  fullH &= fullH >> 1;
+  fullH = (fullH & MaskFile1) * 0xff;
+  uint64_t fullV = occupied & (occupied >> 32);
+  fullV &= fullV >> 16;
+  fullV &= fullV >> 8;
+  fullV = (fullV & 0xff) * MaskFile1;
+  uint64_t fullD = 0;
+  uint64_t fullA = 0;
+  for (int i = 0; i < 15; i++) {
+    uint64_t d = stabilityTables.diagonals[i];
+    fullD |= (occupied & d) == d ? d : 0;
+    uint64_t a = stabilityTables.diagonals[i + 15];
+    fullA |= (occupied & a) == a ? a : 0;
+  }
+
+  // An inner disc is stable if, on each line, the line is full or
+  // one of its neighbors is a stable disc of the same colour.
+  const uint64_t inner = 0x007e7e7e7e7e7e00llu & p;
+  stable |= fullH & fullV & fullD & fullA & inner;
+  while (true) {
+    Bitboard s(stable);
+    uint64_t h = (s.Left() | s.Right()).GetRaw() | fullH;
+    uint64_t v = (s.Up() | s.Down()).GetRaw() | fullV;
+    uint64_t d = (s.LeftUp() | s.RightDown()).GetRaw() | fullD;
+    uint64_t a = (s.RightUp() | s.LeftDown()).GetRaw() | fullA;
+    uint64_t next = stable | (h & v & d & a & inner);
+    if (next == stable) {
+      break;
     }
+    stable = next;
   }
-  return moves;
+
+  return Bitboard(stable);
 }
 
-Bitboard Board::GetOpenSquares(DiskColor color) const {
-  Bitboard occupied = black_ | white_;
-  Bitboard empty = ~occupied;
-  Bitboard open = color == ColorBlack
-                ? (black_.Up() | black_.Down() | black_.Left() | black_.Right()
-                 | black_.LeftUp() | black_.LeftDown() | black_.RightUp() | black_.RightDown()) & empty
-                : (white_.Up() | white_.Down() | white_.Left() | white_.Right()
-                 | white_.LeftUp() | white_.LeftDown() | white_.RightUp() | white_.RightDown()) & empty;
-  return open;
+Bitboard Board::GetFrontierDisks(const Bitboard& player, const Bitboard& opponent) {
+  return player & (~(player | opponent)).GetNeighbors();
+}
+
+Bitboard Board::GetPotentialMoves(const Bitboard& player, const Bitboard& opponent) {
+  return ~(player | opponent) & opponent.GetNeighbors();
 }
 
 TotalScore Board::GetTotalScore() const {
@@ -293,39 +567,76 @@ TotalScore Board::GetTotalScore() const {
 }
 
 uint64_t Board::GetHash() const {
-  uint64_t hash = ZobristTable1[black_.GetRaw() & 0x0f];
-  hash ^= ZobristTable2 [(black_.GetRaw() >> 4 ) & 0x0f];
-  hash ^= ZobristTable3 [(black_.GetRaw() >> 8 ) & 0x0f];
-  hash ^= ZobristTable4 [(black_.GetRaw() >> 12) & 0x0f];
-  hash ^= ZobristTable5 [(black_.GetRaw() >> 16) & 0x0f];
-  hash ^= ZobristTable6 [(black_.GetRaw() >> 20) & 0x0f];
-  hash ^= ZobristTable7 [(black_.GetRaw() >> 24) & 0x0f];
-  hash ^= ZobristTable8 [(black_.GetRaw() >> 28) & 0x0f];
-  hash ^= ZobristTable9 [(black_.GetRaw() >> 32) & 0x0f];
-  hash ^= ZobristTable10[(black_.GetRaw() >> 36) & 0x0f];
-  hash ^= ZobristTable11[(black_.GetRaw() >> 40) & 0x0f];
-  hash ^= ZobristTable12[(black_.GetRaw() >> 44) & 0x0f];
-  hash ^= ZobristTable13[(black_.GetRaw() >> 48) & 0x0f];
-  hash ^= ZobristTable14[(black_.GetRaw() >> 52) & 0x0f];
-  hash ^= ZobristTable15[(black_.GetRaw() >> 56) & 0x0f];
-  hash ^= ZobristTable16[(black_.GetRaw() >> 60)       ];
-  hash ^= ZobristTable17[(white_.GetRaw()      ) & 0x0f];
-  hash ^= ZobristTable18[(white_.GetRaw() >> 4 ) & 0x0f];
-  hash ^= ZobristTable19[(white_.GetRaw() >> 8 ) & 0x0f];
-  hash ^= ZobristTable20[(white_.GetRaw() >> 12) & 0x0f];
-  hash ^= ZobristTable21[(white_.GetRaw() >> 16) & 0x0f];
-  hash ^= ZobristTable22[(white_.GetRaw() >> 20) & 0x0f];
-  hash ^= ZobristTable23[(white_.GetRaw() >> 24) & 0x0f];
-  hash ^= ZobristTable24[(white_.GetRaw() >> 28) & 0x0f];
-  hash ^= ZobristTable25[(white_.GetRaw() >> 32) & 0x0f];
-  hash ^= ZobristTable26[(white_.GetRaw() >> 36) & 0x0f];
-  hash ^= ZobristTable27[(white_.GetRaw() >> 40) & 0x0f];
-  hash ^= ZobristTable28[(white_.GetRaw() >> 44) & 0x0f];
-  hash ^= ZobristTable29[(white_.GetRaw() >> 48) & 0x0f];
-  hash ^= ZobristTable30[(white_.GetRaw() >> 52) & 0x0f];
-  hash ^= ZobristTable31[(white_.GetRaw() >> 56) & 0x0f];
-  hash ^= ZobristTable32[(white_.GetRaw() >> 60)       ];
-  return hash;
+  return GetZobristHash(black_, white_);
+}
+
+Board Board::GetCanonicalBoard() const {
+  Bitboard black = black_;
+  Bitboard white = white_;
+  for (int symmetry = 1; symmetry < SymmetryCount; symmetry++) {
+    Bitboard b = black_.Transform(symmetry);
+    Bitboard w = white_.Transform(symmetry);
+    if (IsLessThan(b, w, black, white)) {
+      black = b;
+      white = w;
+    }
+  }
+  return Board(black, white, nextDisk_);
+}
+
+uint64_t PlayerBoard::GetHash() const {
+  return GetZobristHash(player_, opponent_);
+}
+
+PlayerBoard PlayerBoard::GetCanonicalBoard() const {
+  Bitboard player = player_;
+  Bitboard opponent = opponent_;
+  for (int symmetry = 1; symmetry < SymmetryCount; symmetry++) {
+    Bitboard p = player_.Transform(symmetry);
+    Bitboard o = opponent_.Transform(symmetry);
+    if (IsLessThan(p, o, player, opponent)) {
+      player = p;
+      opponent = o;
+    }
+  }
+  return PlayerBoard(player, opponent);
+}
+
+PlayerBoardHash::PlayerBoardHash(const PlayerBoard& board)
+  : hash_(GetZobristHash(board.GetPlayerBoard(), board.GetOpponentBoard())),
+    swapped_(GetZobristHash(board.GetOpponentBoard(), board.GetPlayerBoard())) {
+}
+
+uint64_t PlayerBoardHash::GetFlipKey(const Bitboard& mask) {
+  uint64_t key = 0;
+  for (Square square : mask) {
+    key ^= ZobristPlayerTable[square.GetRaw()] ^ ZobristOpponentTable[square.GetRaw()];
+  }
+  return key;
+}
+
+uint64_t PlayerBoardHash::GetChild(const Square& square, const Bitboard& mask) const {
+  return swapped_ ^ GetFlipKey(mask) ^ ZobristOpponentTable[square.GetRaw()];
+}
+
+void PlayerBoardHash::DoMove(const Square& square, const Bitboard& mask) {
+  uint64_t key = GetFlipKey(mask);
+  uint64_t hash = swapped_ ^ key ^ ZobristOpponentTable[square.GetRaw()];
+  swapped_ = hash_ ^ key ^ ZobristPlayerTable[square.GetRaw()];
+  hash_ = hash;
+}
+
+void PlayerBoardHash::DoMove(const Square& square, uint64_t child) {
+  // the flip key is child ^ swapped_ ^ ZobristOpponentTable[square]
+  swapped_ = hash_ ^ child ^ swapped_ ^ ZobristPlayerTable[square.GetRaw()] ^ ZobristOpponentTable[square.GetRaw()];
+  hash_ = child;
+}
+
+void PlayerBoardHash::UndoMove(const Square& square, const Bitboard& mask) {
+  uint64_t key = GetFlipKey(mask);
+  uint64_t hash = swapped_ ^ key ^ ZobristPlayerTable[square.GetRaw()];
+  swapped_ = hash_ ^ key ^ ZobristOpponentTable[square.GetRaw()];
+  hash_ = hash;
 }
 
 } // namespace beluga
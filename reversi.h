@@ -1,5 +1,6 @@
 #pragma once
 
+#include "bitop.h"
 #include <cstdint>
 
 namespace beluga {
@@ -25,10 +26,10 @@ public:
   using RawType = int8_t;
 
   Square() noexcept = default;
-  Square(const Square& src) noexcept = default;
+  constexpr Square(const Square& src) noexcept = default;
   Square(Square&& src) noexcept = default;
-  Square(RawType raw) noexcept : raw_(raw) {}
-  Square(RawType x, RawType y) noexcept : raw_(y * 8 + x) {}
+  constexpr Square(RawType raw) noexcept : raw_(raw) {}
+  constexpr Square(RawType x, RawType y) noexcept : raw_(y * 8 + x) {}
 
   Square& operator=(const Square&) = default;
   Square& operator=(Square&&) = default;
@@ -77,7 +78,7 @@ public:
     return Square(64);
   }
 
-  static Square Invalid() {
+  static constexpr Square Invalid() {
     return Square(-1);
   }
 
@@ -98,6 +99,15 @@ private:
 
 };
 
+// The 8 symmetries of the board are the combinations of these flags.
+enum Symmetry : int {
+  SymmetryIdentity   = 0x00,
+  SymmetryVertical   = 0x01,
+  SymmetryHorizontal = 0x02,
+  SymmetryDiagonal   = 0x04,
+  SymmetryCount      = 8,
+};
+
 class Bitboard {
 public:
 
@@ -109,11 +119,11 @@ public:
   Bitboard& operator=(const Bitboard&) = default;
   Bitboard& operator=(Bitboard&&) = default;
 
-  bool operator==(const Bitboard& rhs) {
+  constexpr bool operator==(const Bitboard& rhs) const {
     return raw_ == rhs.raw_;
   }
 
-  bool operator!=(const Bitboard& rhs) {
+  constexpr bool operator!=(const Bitboard& rhs) const {
     return raw_ != rhs.raw_;
   }
 
@@ -180,6 +190,10 @@ public:
     return Bitboard(raw_ << 9) & MaskCol2to8();
   }
 
+  constexpr Bitboard GetNeighbors() const {
+    return LeftUp() | Up() | RightUp() | Left() | Right() | LeftDown() | Down() | RightDown();
+  }
+
   static constexpr Bitboard MaskCol1to7() {
     return 0b0111111101111111011111110111111101111111011111110111111101111111;
   }
@@ -213,14 +227,7 @@ public:
   }
 
   int Count() const {
-    uint64_t x = raw_;
-    x = x - ((x >> 1) & 0x5555555555555555llu);
-    x = (x & 0x3333333333333333llu) + ((x >> 2) & 0x3333333333333333llu);
-    x = (x + (x >> 4)) & 0x0F0F0F0F0F0F0F0Fllu;
-    x = x + (x >> 8);
-    x = x + (x >> 16);
-    x = x + (x >> 32);
-    return static_cast<int>(x & 0x000000000000007Fllu);
+    return PopCount(raw_);
   }
 
   bool Get(const Square& square) const {
@@ -243,9 +250,106 @@ public:
     if (raw_ == 0) {
       return Square::Invalid();
     }
-    uint64_t mask = raw_ - 1;
-    raw_ &= mask;
-    return Square(Bitboard(raw_ ^ mask).Count());
+    Square square(static_cast<Square::RawType>(CountTrailingZeros(raw_)));
+    raw_ = ClearLowestBit(raw_);
+    return square;
+  }
+
+  uint64_t Extract(const Bitboard& mask) const {
+    return ParallelExtract(raw_, mask.raw_);
+  }
+
+  // a1 <=> a8
+  Bitboard FlipVertical() const {
+    uint64_t x = raw_;
+    x = ((x >>  8) & 0x00ff00ff00ff00ffllu) | ((x & 0x00ff00ff00ff00ffllu) <<  8);
+    x = ((x >> 16) & 0x0000ffff0000ffffllu) | ((x & 0x0000ffff0000ffffllu) << 16);
+    x = (x >> 32) | (x << 32);
+    return Bitboard(x);
+  }
+
+  // a1 <=> h1
+  Bitboard FlipHorizontal() const {
+    uint64_t x = raw_;
+    x = ((x >> 1) & 0x5555555555555555llu) | ((x & 0x5555555555555555llu) << 1);
+    x = ((x >> 2) & 0x3333333333333333llu) | ((x & 0x3333333333333333llu) << 2);
+    x = ((x >> 4) & 0x0f0f0f0f0f0f0f0fllu) | ((x & 0x0f0f0f0f0f0f0f0fllu) << 4);
+    return Bitboard(x);
+  }
+
+  // a8 <=> h1
+  Bitboard FlipDiagonal() const {
+    uint64_t x = raw_;
+    uint64_t t;
+    t = 0x0f0f0f0f00000000llu & (x ^ (x << 28));
+    x ^= t ^ (t >> 28);
+    t = 0x3333000033330000llu & (x ^ (x << 14));
+    x ^= t ^ (t >> 14);
+    t = 0x5500550055005500llu & (x ^ (x << 7));
+    x ^= t ^ (t >> 7);
+    return Bitboard(x);
+  }
+
+  // a1 <=> h8
+  Bitboard FlipAntiDiagonal() const {
+    uint64_t x = raw_;
+    uint64_t t;
+    t = x ^ (x << 36);
+    x ^= 0xf0f0f0f00f0f0f0fllu & (t ^ (x >> 36));
+    t = 0xcccc0000cccc0000llu & (x ^ (x << 18));
+    x ^= t ^ (t >> 18);
+    t = 0xaa00aa00aa00aa00llu & (x ^ (x << 9));
+    x ^= t ^ (t >> 9);
+    return Bitboard(x);
+  }
+
+  // symmetry is a combination of SymmetryVertical, SymmetryHorizontal and
+  // SymmetryDiagonal, which are applied in this order.
+  Bitboard Transform(int symmetry) const {
+    Bitboard x = *this;
+    if (symmetry & SymmetryVertical) {
+      x = x.FlipVertical();
+    }
+    if (symmetry & SymmetryHorizontal) {
+      x = x.FlipHorizontal();
+    }
+    if (symmetry & SymmetryDiagonal) {
+      x = x.FlipDiagonal();
+    }
+    return x;
+  }
+
+  class Iterator {
+  public:
+
+    explicit Iterator(uint64_t raw) : raw_(raw) {}
+
+    Square operator*() const {
+      return Square(static_cast<Square::RawType>(CountTrailingZeros(raw_)));
+    }
+
+    Iterator& operator++() {
+      raw_ = ClearLowestBit(raw_);
+      return *this;
+    }
+
+    bool operator!=(const Iterator& rhs) const {
+      return raw_ != rhs.raw_;
+    }
+
+  private:
+
+    uint64_t raw_;
+
+  };
+
+  // for (Square square : bitboard) { ... }
+  Iterator begin() const {
+    return Iterator(raw_);
+  }
+
+  Iterator end() const {
+    return Iterator(0);
   }
 
 private:
@@ -278,6 +382,8 @@ public:
   Board() = default;
   Board(const Board& src) = default;
   Board(Board&& src) = default;
+  Board(const Bitboard& black, const Bitboard& white, DiskColor nextDisk)
+    : black_(black), white_(white), nextDisk_(nextDisk) {}
 
   Board& operator=(const Board&) = default;
   Board& operator=(Board&&) = default;
@@ -376,15 +482,45 @@ public:
 
   Bitboard GenerateMoves(DiskColor color) const;
 
+  static Bitboard GenerateMoves(const Bitboard& player, const Bitboard& opponent);
+
+  static Bitboard GetFlipMask(const Square& square, const Bitboard& player, const Bitboard& opponent);
+
+  // The number of discs flipped when the player moves to the last empty square.
+  // All the squares other than square and player's discs must be the opponent's.
+  static int CountLastFlips(const Square& square, const Bitboard& player);
+
+  // the discs which can never be flipped (a conservative estimate)
+  Bitboard GetStableDisks(DiskColor color) const;
+
+  // the discs adjacent to an empty square
+  Bitboard GetFrontierDisks(DiskColor color) const;
+
+  // the empty squares adjacent to the opponent's discs
+  Bitboard GetPotentialMoves(DiskColor color) const;
+
+  static Bitboard GetStableDisks(const Bitboard& player, const Bitboard& opponent);
+
+  static Bitboard GetFrontierDisks(const Bitboard& player, const Bitboard& opponent);
+
+  static Bitboard GetPotentialMoves(const Bitboard& player, const Bitboard& opponent);
+
   TotalScore GetTotalScore() const;
 
   uint64_t GetHash() const;
 
-private:
+  Board Transform(int symmetry) const {
+    return Board(black_.Transform(symmetry), white_.Transform(symmetry), nextDisk_);
+  }
 
-  bool CanMove(const Square& square, DiskColor color) const;
+  // the representative of the symmetric boards
+  Board GetCanonicalBoard() const;
 
-  Bitboard GetOpenSquares(DiskColor color) const;
+  uint64_t GetCanonicalHash() const {
+    return GetCanonicalBoard().GetHash();
+  }
+
+private:
 
   Bitboard black_;
   Bitboard white_;
@@ -392,4 +528,158 @@ private:
 
 };
 
+// The board seen from the side to move.
+// It has no colour, so the player and the opponent are simply swapped on
+// every move and pass. This keeps the search free from colour branches and
+// makes a board only 16 bytes.
+class PlayerBoard {
+public:
+
+  PlayerBoard() = default;
+  PlayerBoard(const PlayerBoard& src) = default;
+  PlayerBoard(PlayerBoard&& src) = default;
+  PlayerBoard(const Bitboard& player, const Bitboard& opponent)
+    : player_(player), opponent_(opponent) {}
+  explicit PlayerBoard(const Board& board)
+    : player_(board.GetNextDisk() == ColorBlack ? board.GetBlackBoard() : board.GetWhiteBoard()),
+      opponent_(board.GetNextDisk() == ColorBlack ? board.GetWhiteBoard() : board.GetBlackBoard()) {}
+
+  PlayerBoard& operator=(const PlayerBoard&) = default;
+  PlayerBoard& operator=(PlayerBoard&&) = default;
+
+  bool operator==(const PlayerBoard& rhs) const {
+    return player_ == rhs.player_
+        && opponent_ == rhs.opponent_;
+  }
+
+  Board ToBoard(DiskColor nextDisk) const {
+    return nextDisk == ColorBlack
+         ? Board(player_, opponent_, ColorBlack)
+         : Board(opponent_, player_, ColorWhite);
+  }
+
+  Bitboard GetPlayerBoard() const {
+    return player_;
+  }
+
+  Bitboard GetOpponentBoard() const {
+    return opponent_;
+  }
+
+  Bitboard GetEmptyBoard() const {
+    return ~(player_ | opponent_);
+  }
+
+  bool CanMove(const Square& square) const {
+    return !(player_ | opponent_).Get(square)
+        && Board::GetFlipMask(square, player_, opponent_) != Bitboard(0);
+  }
+
+  bool IsEnd() const {
+    return MustPass()
+        && Board::GenerateMoves(opponent_, player_) == Bitboard(0);
+  }
+
+  bool MustPass() const {
+    return GenerateMoves() == Bitboard(0);
+  }
+
+  Bitboard GetFlipMask(const Square& square) const {
+    return Board::GetFlipMask(square, player_, opponent_);
+  }
+
+  Bitboard DoMove(const Square& square) {
+    Bitboard mask = GetFlipMask(square);
+    DoMove(square, mask);
+    return mask;
+  }
+
+  // mask must be GetFlipMask(square)
+  void DoMove(const Square& square, const Bitboard& mask) {
+    Bitboard player = player_ ^ mask;
+    player.Set(square);
+    player_ = opponent_ ^ mask;
+    opponent_ = player;
+  }
+
+  void UndoMove(const Square& square, const Bitboard& mask) {
+    Bitboard player = opponent_ ^ mask;
+    player.Unset(square);
+    opponent_ = player_ ^ mask;
+    player_ = player;
+  }
+
+  void Pass() {
+    Bitboard player = player_;
+    player_ = opponent_;
+    opponent_ = player;
+  }
+
+  Bitboard GenerateMoves() const {
+    return Board::GenerateMoves(player_, opponent_);
+  }
+
+  // the number of player's discs minus the number of opponent's discs
+  int GetDiskDifference() const {
+    return player_.Count() - opponent_.Count();
+  }
+
+  uint64_t GetHash() const;
+
+  PlayerBoard Transform(int symmetry) const {
+    return PlayerBoard(player_.Transform(symmetry), opponent_.Transform(symmetry));
+  }
+
+  // the representative of the symmetric boards
+  PlayerBoard GetCanonicalBoard() const;
+
+  uint64_t GetCanonicalHash() const {
+    return GetCanonicalBoard().GetHash();
+  }
+
+private:
+
+  Bitboard player_;
+  Bitboard opponent_;
+
+};
+
+// Zobrist hash of a PlayerBoard which is updated incrementally.
+// The hash of the board seen from the other side is kept together,
+// because every move and pass swaps the player and the opponent.
+class PlayerBoardHash {
+public:
+
+  PlayerBoardHash() = default;
+  explicit PlayerBoardHash(const PlayerBoard& board);
+
+  uint64_t Get() const {
+    return hash_;
+  }
+
+  // the hash after DoMove(square, mask) without changing this
+  uint64_t GetChild(const Square& square, const Bitboard& mask) const;
+
+  void DoMove(const Square& square, const Bitboard& mask);
+
+  // DoMove with child = GetChild(square, mask), which does not need the flip key again
+  void DoMove(const Square& square, uint64_t child);
+
+  void UndoMove(const Square& square, const Bitboard& mask);
+
+  void Pass() {
+    uint64_t hash = hash_;
+    hash_ = swapped_;
+    swapped_ = hash;
+  }
+
+private:
+
+  static uint64_t GetFlipKey(const Bitboard& mask);
+
+  uint64_t hash_;
+  uint64_t swapped_;
+
+};
+
 } // namespace beluga
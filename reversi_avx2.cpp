@@ -0,0 +1,91 @@
+#include "reversi.h"
+
+#if defined(__x86_64__) || defined(_M_X64)
+
+#include <immintrin.h>
+
+namespace {
+
+// lanes: { Left/Right, Up/Down, LeftUp/RightDown, RightUp/LeftDown }
+inline __m256i Shift1() {
+  return _mm256_set_epi64x(7, 9, 8, 1);
+}
+
+inline __m256i Shift2() {
+  return _mm256_set_epi64x(14, 18, 16, 2);
+}
+
+// horizontal and diagonal runs must not wrap around the board edge
+inline __m256i MaskOpponent(const beluga::Bitboard& opponent) {
+  const uint64_t inner = (beluga::Bitboard::MaskCol1to7() & beluga::Bitboard::MaskCol2to8()).GetRaw();
+  const uint64_t o = opponent.GetRaw();
+  return _mm256_set_epi64x(o & inner, o & inner, o, o & inner);
+}
+
+inline uint64_t ReduceOr(__m256i x) {
+  __m128i y = _mm_or_si128(_mm256_castsi256_si128(x), _mm256_extracti128_si256(x, 1));
+  y = _mm_or_si128(y, _mm_unpackhi_epi64(y, y));
+  return static_cast<uint64_t>(_mm_cvtsi128_si64(y));
+}
+
+} // namespace
+
+namespace beluga {
+
+namespace avx2 {
+
+Bitboard GenerateMoves(const Bitboard& player, const Bitboard& opponent) {
+  const __m256i s1 = Shift1();
+  const __m256i s2 = Shift2();
+  const __m256i pp = _mm256_set1_epi64x(player.GetRaw());
+  const __m256i oo = MaskOpponent(opponent);
+
+  __m256i fl = _mm256_and_si256(oo, _mm256_sllv_epi64(pp, s1));
+  __m256i fr = _mm256_and_si256(oo, _mm256_srlv_epi64(pp, s1));
+  fl = _mm256_or_si256(fl, _mm256_and_si256(oo, _mm256_sllv_epi64(fl, s1)));
+  fr = _mm256_or_si256(fr, _mm256_and_si256(oo, _mm256_srlv_epi64(fr, s1)));
+  __m256i pl = _mm256_and_si256(oo, _mm256_sllv_epi64(oo, s1));
+  __m256i pr = _mm256_and_si256(oo, _mm256_srlv_epi64(oo, s1));
+  fl = _mm256_or_si256(fl, _mm256_and_si256(pl, _mm256_sllv_epi64(fl, s2)));
+  fr = _mm256_or_si256(fr, _mm256_and_si256(pr, _mm256_srlv_epi64(fr, s2)));
+  fl = _mm256_or_si256(fl, _mm256_and_si256(pl, _mm256_sllv_epi64(fl, s2)));
+  fr = _mm256_or_si256(fr, _mm256_and_si256(pr, _mm256_srlv_epi64(fr, s2)));
+
+  __m256i moves = _mm256_or_si256(_mm256_sllv_epi64(fl, s1), _mm256_srlv_epi64(fr, s1));
+  return Bitboard(ReduceOr(moves)) & ~(player | opponent);
+}
+
+Bitboard GetFlipMask(const Square& square, const Bitboard& player, const Bitboard& opponent) {
+  const __m256i s1 = Shift1();
+  const __m256i s2 = Shift2();
+  const __m256i pp = _mm256_set1_epi64x(player.GetRaw());
+  const __m256i oo = MaskOpponent(opponent);
+  const __m256i mm = _mm256_set1_epi64x(1llu << square.GetRaw());
+  const __m256i zero = _mm256_setzero_si256();
+
+  // runs of opponent's discs adjacent to the square
+  __m256i fl = _mm256_and_si256(oo, _mm256_sllv_epi64(mm, s1));
+  __m256i fr = _mm256_and_si256(oo, _mm256_srlv_epi64(mm, s1));
+  fl = _mm256_or_si256(fl, _mm256_and_si256(oo, _mm256_sllv_epi64(fl, s1)));
+  fr = _mm256_or_si256(fr, _mm256_and_si256(oo, _mm256_srlv_epi64(fr, s1)));
+  __m256i pl = _mm256_and_si256(oo, _mm256_sllv_epi64(oo, s1));
+  __m256i pr = _mm256_and_si256(oo, _mm256_srlv_epi64(oo, s1));
+  fl = _mm256_or_si256(fl, _mm256_and_si256(pl, _mm256_sllv_epi64(fl, s2)));
+  fr = _mm256_or_si256(fr, _mm256_and_si256(pr, _mm256_srlv_epi64(fr, s2)));
+  fl = _mm256_or_si256(fl, _mm256_and_si256(pl, _mm256_sllv_epi64(fl, s2)));
+  fr = _mm256_or_si256(fr, _mm256_and_si256(pr, _mm256_srlv_epi64(fr, s2)));
+
+  // a run is flipped only if it is closed by the player's disc
+  __m256i outflankL = _mm256_and_si256(pp, _mm256_sllv_epi64(fl, s1));
+  __m256i outflankR = _mm256_and_si256(pp, _mm256_srlv_epi64(fr, s1));
+  fl = _mm256_andnot_si256(_mm256_cmpeq_epi64(outflankL, zero), fl);
+  fr = _mm256_andnot_si256(_mm256_cmpeq_epi64(outflankR, zero), fr);
+
+  return Bitboard(ReduceOr(_mm256_or_si256(fl, fr)));
+}
+
+} // namespace avx2
+
+} // namespace beluga
+
+#endif
@@ -1,5 +1,8 @@
 #include "search.h"
+#include "bitop.h"
 #include <algorithm>
+#include <thread>
+#include <vector>
 #include <ctime>
 
 #define ROOT_MOVE_SHUFFLE 1
@@ -10,28 +13,137 @@
 
 namespace beluga {
 
-Searcher::Searcher(const std::shared_ptr<Evaluator>& eval, SearchHandler* handler)
-  : random_(static_cast<unsigned>(time(nullptr))), eval_(eval), handler_(handler)
+// Solvers specialized for the last few empty squares.
+// They iterate over the empty squares directly, and maintain neither
+// the tree nor the PV.
+template <int n>
+Score SolveLastEmpties(const Bitboard& player, const Bitboard& opponent,
+                       Score alpha, Score beta, bool passed,
+                       const Square* empties, uint64_t& nodes) {
+  nodes++;
+
+  Score bestScore = -ScoreInfinity;
+
+  for (int i = 0; i < n; i++) {
+    Bitboard mask = Board::GetFlipMask(empties[i], player, opponent);
+    if (mask == Bitboard(0)) {
+      continue;
+    }
+
+    Square rest[n - 1];
+    for (int j = 0, k = 0; j < n; j++) {
+      if (j != i) {
+        rest[k++] = empties[j];
+      }
+    }
+
+    Bitboard next = player ^ mask;
+    next.Set(empties[i]);
+    Score score = -SolveLastEmpties<n - 1>(opponent ^ mask, next,
+                                            -beta, -ScoreMax(alpha, bestScore), false,
+                                            rest, nodes);
+    if (score > bestScore) {
+      bestScore = score;
+      if (bestScore >= beta) {
+        break;
+      }
+    }
+  }
+
+  // pass
+  if (bestScore == -ScoreInfinity) {
+    if (passed) {
+      return (player.Count() - opponent.Count()) * ScoreScale;
+    }
+    return -SolveLastEmpties<n>(opponent, player, -beta, -alpha, true, empties, nodes);
+  }
+
+  return bestScore;
+}
+
+template <>
+Score SolveLastEmpties<1>(const Bitboard& player, const Bitboard& opponent,
+                          Score, Score, bool passed,
+                          const Square* empties, uint64_t& nodes) {
+  nodes++;
+
+  // the final score is counted from the flipped discs
+  int diff = player.Count() - opponent.Count();
+
+  int flips = Board::CountLastFlips(empties[0], player);
+  if (flips != 0) {
+    return (diff + flips * 2 + 1) * ScoreScale;
+  }
+
+  // the opponent moves to the square instead
+  if (!passed) {
+    flips = Board::CountLastFlips(empties[0], opponent);
+    if (flips != 0) {
+      nodes++;
+      return (diff - flips * 2 - 1) * ScoreScale;
+    }
+  }
+
+  return diff * ScoreScale;
+}
+
+Searcher::Searcher(const std::shared_ptr<const Evaluator>& eval, SearchHandler* handler, size_t evalCacheSize)
+  : stop_(false), helperStop_(false), random_(static_cast<unsigned>(time(nullptr))), eval_(eval), handler_(handler)
 #if TT
-  , tt_(new TTElement[TTSize])
+  , tt_(new TTEntry[TTSize])
 #endif
+  , threadCount_(1), evalCacheMask_(0), statistics_()
 {
 #if TT
   for (uint64_t hashKey = 0; hashKey < TTSize; hashKey++) {
-    tt_.get()[hashKey].hash = ~hashKey;
+    tt_[hashKey].key.store(~hashKey, std::memory_order_relaxed);
+    tt_[hashKey].data.store(0, std::memory_order_relaxed);
   }
 #endif
+
+  if (evalCacheSize != 0) {
+    size_t size = 1;
+    while (size * 2 <= evalCacheSize) {
+      size *= 2;
+    }
+    evalCache_.reset(new std::atomic<uint64_t>[size]);
+    evalCacheMask_ = size - 1;
+    ClearEvalCache();
+  }
+}
+
+void Searcher::ClearEvalCache() {
+  // an empty entry matches only the hashes whose upper 48 bits are 0
+  for (uint64_t index = 0; evalCache_ && index <= evalCacheMask_; index++) {
+    evalCache_[index].store(0, std::memory_order_relaxed);
+  }
+}
+
+void Searcher::InitTree(Tree& tree, const Board& board, bool helper) {
+  tree.ply = 0;
+  tree.board = PlayerBoard(board);
+  tree.hash = PlayerBoardHash(tree.board);
+  tree.network = eval_->GetNetwork().get();
+  if (tree.network != nullptr) {
+    tree.accumulator = NetworkAccumulator(*tree.network, tree.board);
+  } else {
+    tree.features = FeatureIndices(tree.board);
+  }
+  tree.nodes = 0;
+  tree.evalCacheProbes = 0;
+  tree.evalCacheHits = 0;
+  tree.helper = helper;
 }
 
 SearchResult Searcher::Search(const Board& board, int maxDepth, int endingDepth) {
+  statistics_ = SearchStatistics();
+
   if (board.MustPass()) {
     return { Square::Invalid(), 0 , false };
   }
 
   Tree tree;
-  tree.ply = 0;
-  tree.board = board;
-  tree.nodes = 0;
+  InitTree(tree, board, false);
 
   Node& node = tree.stack[0];
 
@@ -51,6 +163,7 @@ SearchResult Searcher::Search(const Board& board, int maxDepth, int endingDepth)
       handler_->OnEnding(node.pv, node.moves[0].score, tree.nodes);
     }
 
+    statistics_.nodes = tree.nodes;
     return { node.moves[0].move, node.moves[0].score, true };
   }
 
@@ -62,13 +175,55 @@ SearchResult Searcher::Search(const Board& board, int maxDepth, int endingDepth)
   std::shuffle(node.moves, node.moves + node.nmoves, random_);
 #endif
 
-  for (int depth = DepthOnePly; depth < maxDepth + DepthOnePly; depth += DepthOnePly) {
+  // the trees of the helpers are kept for the statistics after their threads end
+  helperStop_ = false;
+  std::vector<std::unique_ptr<Tree>> helperTrees;
+  std::vector<std::thread> helpers;
+  for (int ti = 1; ti < threadCount_; ti++) {
+    helperTrees.emplace_back(new Tree);
+    Tree* helperTree = helperTrees.back().get();
+    const unsigned seed = random_();
+    helpers.emplace_back([this, helperTree, &board, seed, ti, maxDepth]() {
+      InitTree(*helperTree, board, true);
+      helperTree->stack[0].pv.Clear();
+      GenerateMoves(*helperTree, Square::Invalid(), 0, 0, 0);
+
+      Node& root = helperTree->stack[0];
+      std::mt19937 random(seed);
+      std::shuffle(root.moves, root.moves + root.nmoves, random);
+
+      Iterate(*helperTree, DepthOnePly + (ti % 2) * DepthOnePly, maxDepth);
+    });
+  }
+
+  Iterate(tree, DepthOnePly, maxDepth);
+
+  helperStop_ = true;
+  for (auto& helper : helpers) {
+    helper.join();
+  }
+
+  statistics_.nodes = tree.nodes;
+  statistics_.evalCacheProbes = tree.evalCacheProbes;
+  statistics_.evalCacheHits = tree.evalCacheHits;
+  for (const auto& helperTree : helperTrees) {
+    statistics_.nodes += helperTree->nodes;
+    statistics_.evalCacheProbes += helperTree->evalCacheProbes;
+    statistics_.evalCacheHits += helperTree->evalCacheHits;
+  }
+  return { node.moves[0].move, node.moves[0].score, false };
+}
+
+void Searcher::Iterate(Tree& tree, int firstDepth, int maxDepth) {
+  Node& node = tree.stack[0];
+
+  for (int depth = firstDepth; depth < maxDepth + DepthOnePly; depth += DepthOnePly) {
     // clear score values
     for (int mi = 1; mi < node.nmoves; mi++) {
       node.moves[mi].score = -ScoreInfinity;
     }
 
-    if (depth == DepthOnePly) {
+    if (depth == firstDepth) {
       // initial depth
       Search(tree, depth, -ScoreInfinity, ScoreInfinity, false);
 
@@ -79,7 +234,7 @@ SearchResult Searcher::Search(const Board& board, int maxDepth, int endingDepth)
       Score beta  = node.moves[0].score + delta;
       while (true) {
         Score score = Search(tree, depth, alpha, beta, false);
-        if (stop_.load()) {
+        if (IsStopped(tree)) {
           break;
         }
 
@@ -87,12 +242,12 @@ SearchResult Searcher::Search(const Board& board, int maxDepth, int endingDepth)
           break;
         } else if (score <= alpha) {
           alpha = score - delta;
-          if (handler_ != nullptr) {
+          if (handler_ != nullptr && !tree.helper) {
             handler_->OnFailLow(depth, score, tree.nodes);
           }
         } else if (score >= beta) {
           beta = score + delta;
-          if (handler_ != nullptr) {
+          if (handler_ != nullptr && !tree.helper) {
             handler_->OnFailHigh(depth, score, tree.nodes);
           }
         }
@@ -100,7 +255,7 @@ SearchResult Searcher::Search(const Board& board, int maxDepth, int endingDepth)
       }
     }
 
-    if (stop_.load()) {
+    if (IsStopped(tree)) {
       break;
     }
 
@@ -109,17 +264,19 @@ SearchResult Searcher::Search(const Board& board, int maxDepth, int endingDepth)
       return lhs.score > rhs.score;
     });
 
+    if (tree.helper) {
+      continue;
+    }
+
     if (handler_ != nullptr) {
       handler_->OnIterate(depth, node.pv, node.moves[0].score, tree.nodes);
     }
 
-    StorePV(board, node.pv, node.moves[0].score);
+    StorePV(tree.board, node.pv, node.moves[0].score);
   }
-
-  return { node.moves[0].move, node.moves[0].score, false };
 }
 
-void Searcher::StorePV(Board board, const PV& pv, Score score) {
+void Searcher::StorePV(PlayerBoard board, const PV& pv, Score score) {
 #if TT
   for (int i = 0; i < pv.length; i++) {
     if (board.MustPass()) {
@@ -129,14 +286,62 @@ void Searcher::StorePV(Board board, const PV& pv, Score score) {
     uint64_t hash = board.GetHash();
     uint64_t hashKey = hash & TTMask;
     int depth = (pv.length - i) * DepthOnePly;
-    tt_.get()[hashKey] = { hash, score, depth, TTActual, pv.moves[i] };
+    StoreTT(hashKey, { hash, score, depth, TTActual, pv.moves[i] });
 
     board.DoMove(pv.moves[i]);
   }
 #endif
 }
 
+Searcher::TTElement Searcher::LoadTT(uint64_t hashKey) const {
+  const TTEntry& entry = tt_[hashKey];
+  const uint64_t key = entry.key.load(std::memory_order_relaxed);
+  const uint64_t data = entry.data.load(std::memory_order_relaxed);
+
+  TTElement elem;
+  elem.hash = key ^ data;
+  elem.score = static_cast<Score>(static_cast<uint16_t>(data));
+  elem.depth = static_cast<int16_t>(static_cast<uint16_t>(data >> 16));
+  elem.type = static_cast<TTType>(static_cast<uint8_t>(data >> 32));
+  elem.bestMove = Square(static_cast<Square::RawType>(static_cast<uint8_t>(data >> 40)));
+  return elem;
+}
+
+void Searcher::StoreTT(uint64_t hashKey, const TTElement& elem) {
+  const uint64_t data = static_cast<uint64_t>(static_cast<uint16_t>(elem.score))
+                      | static_cast<uint64_t>(static_cast<uint16_t>(elem.depth)) << 16
+                      | static_cast<uint64_t>(static_cast<uint8_t>(elem.type)) << 32
+                      | static_cast<uint64_t>(static_cast<uint8_t>(elem.bestMove.GetRaw())) << 40;
+  TTEntry& entry = tt_[hashKey];
+  entry.key.store(elem.hash ^ data, std::memory_order_relaxed);
+  entry.data.store(data, std::memory_order_relaxed);
+}
+
 Score Searcher::SearchEnding(Tree& tree, Score alpha, Score beta, bool passed) {
+  if (tree.ply != 0) {
+    Bitboard empty = tree.board.GetEmptyBoard();
+    int emptyCount = empty.Count();
+    if (emptyCount <= 4) {
+      Square empties[4];
+      int ei = 0;
+      for (Square square : empty) {
+        empties[ei++] = square;
+      }
+
+      Bitboard player = tree.board.GetPlayerBoard();
+      Bitboard opponent = tree.board.GetOpponentBoard();
+      Node& node = tree.stack[tree.ply];
+      node.pv.Clear();
+      switch (emptyCount) {
+      case 4: return SolveLastEmpties<4>(player, opponent, alpha, beta, passed, empties, tree.nodes);
+      case 3: return SolveLastEmpties<3>(player, opponent, alpha, beta, passed, empties, tree.nodes);
+      case 2: return SolveLastEmpties<2>(player, opponent, alpha, beta, passed, empties, tree.nodes);
+      case 1: return SolveLastEmpties<1>(player, opponent, alpha, beta, passed, empties, tree.nodes);
+      default: return tree.board.GetDiskDifference() * ScoreScale;
+      }
+    }
+  }
+
   tree.nodes++;
 
   Node& node = tree.stack[tree.ply];
@@ -147,15 +352,12 @@ Score Searcher::SearchEnding(Tree& tree, Score alpha, Score beta, bool passed) {
   // pass
   if (node.nmoves == 0) {
     if (passed) {
-      int bc      = tree.board.GetBlackBoard().Count();
-      int wc      = tree.board.GetWhiteBoard().Count();
-      Score score = (bc - wc) * ScoreScale;
-      return tree.board.GetNextDisk() == ColorBlack ? score : -score;
+      return tree.board.GetDiskDifference() * ScoreScale;
     }
 
-    tree.board.Pass();
+    Pass(tree);
     Score score = -SearchEnding(tree, -beta, -alpha, true);
-    tree.board.Pass();
+    Pass(tree);
     return score;
   }
 
@@ -169,11 +371,10 @@ Score Searcher::SearchEnding(Tree& tree, Score alpha, Score beta, bool passed) {
 
     Score newAlpha = ScoreMax(alpha, bestScore);
 
-    Bitboard mask = tree.board.DoMove(m.move);
-    tree.ply++;
+    Bitboard mask = tree.board.GetFlipMask(m.move);
+    DoEndingMove(tree, m.move, mask);
     m.score = -SearchEnding(tree, -beta, -newAlpha, false);
-    tree.board.UndoMove(m.move, mask);
-    tree.ply--;
+    UndoEndingMove(tree, m.move, mask);
 
     if (stop_.load()) {
       return 0;
@@ -201,17 +402,16 @@ Score Searcher::Search(Tree& tree, int depth, Score alpha, Score beta, bool pass
   }
 
   if (depth < DepthOnePly) {
-    Score score = eval_->Evaluate(tree.board);
-    return tree.board.GetNextDisk() == ColorBlack ? score : -score;
+    return Evaluate(tree);
   }
 
   bool isPV = (beta != alpha + 1);
 
   Square ttMove = Square::Invalid();
 #if TT
-  uint64_t hash = tree.board.GetHash();
+  uint64_t hash = tree.hash.Get();
   uint64_t hashKey = hash & TTMask;
-  auto ttElem = tt_.get()[hashKey];
+  auto ttElem = LoadTT(hashKey);
   if (ttElem.hash == hash) {
     if (!isPV && ttElem.depth >= depth) {
       switch (ttElem.type) {
@@ -221,10 +421,12 @@ Score Searcher::Search(Tree& tree, int depth, Score alpha, Score beta, bool pass
         if (ttElem.score <= alpha) {
           return ttElem.score;
         }
+        break;
       case TTLower:
         if (ttElem.score >= beta) {
           return ttElem.score;
         }
+        break;
       }
     }
     ttMove = ttElem.bestMove;
@@ -251,15 +453,12 @@ Score Searcher::Search(Tree& tree, int depth, Score alpha, Score beta, bool pass
   // pass
   if (node.nmoves == 0) {
     if (passed) {
-      int bc      = tree.board.GetBlackBoard().Count();
-      int wc      = tree.board.GetWhiteBoard().Count();
-      Score score = (bc - wc) * ScoreScale;
-      return tree.board.GetNextDisk() == ColorBlack ? score : -score;
+      return tree.board.GetDiskDifference() * ScoreScale;
     }
 
-    tree.board.Pass();
+    Pass(tree);
     Score score = -Search(tree, depth, -beta, -alpha, true);
-    tree.board.Pass();
+    Pass(tree);
     return score;
   }
 
@@ -276,8 +475,15 @@ Score Searcher::Search(Tree& tree, int depth, Score alpha, Score beta, bool pass
     Score newAlpha = ScoreMax(alpha, bestScore);
     int newDepth = depth - DepthOnePly;
 
-    Bitboard mask = tree.board.DoMove(m.move);
-    tree.ply++;
+    Bitboard mask = tree.board.GetFlipMask(m.move);
+    uint64_t childHash = tree.hash.GetChild(m.move, mask);
+#if TT
+    if (newDepth >= DepthOnePly) {
+      // the child probes the transposition table soon
+      Prefetch(&tt_[childHash & TTMask]);
+    }
+#endif
+    DoMove(tree, m.move, mask, childHash);
 #if NEGA_SCOUT
     if (isFirst || beta == newAlpha + 1) {
 #endif
@@ -290,10 +496,9 @@ Score Searcher::Search(Tree& tree, int depth, Score alpha, Score beta, bool pass
       }
     }
 #endif
-    tree.board.UndoMove(m.move, mask);
-    tree.ply--;
+    UndoMove(tree, m.move, mask);
 
-    if (stop_.load()) {
+    if (IsStopped(tree)) {
       return 0;
     }
 
@@ -318,13 +523,85 @@ Score Searcher::Search(Tree& tree, int depth, Score alpha, Score beta, bool pass
     } else {
       ttType = TTActual;
     }
-    tt_.get()[hashKey] = { hash, bestScore, depth, ttType, bestMove };
+    StoreTT(hashKey, { hash, bestScore, depth, ttType, bestMove });
   }
 #endif
 
   return bestScore;
 }
 
+void Searcher::DoMove(Tree& tree, const Square& move, const Bitboard& mask, uint64_t childHash) {
+  if (tree.network != nullptr) {
+    tree.accumulator.DoMove(*tree.network, move, mask);
+  } else {
+    tree.features.DoMove(move, mask);
+  }
+  tree.board.DoMove(move, mask);
+  tree.hash.DoMove(move, childHash);
+  tree.ply++;
+}
+
+void Searcher::UndoMove(Tree& tree, const Square& move, const Bitboard& mask) {
+  tree.board.UndoMove(move, mask);
+  tree.hash.UndoMove(move, mask);
+  tree.ply--;
+  if (tree.network != nullptr) {
+    tree.accumulator.UndoMove(*tree.network, move, mask);
+  } else {
+    tree.features.UndoMove(move, mask);
+  }
+}
+
+void Searcher::Pass(Tree& tree) {
+  tree.board.Pass();
+  tree.hash.Pass();
+  if (tree.network != nullptr) {
+    tree.accumulator.Pass();
+  } else {
+    tree.features.Pass();
+  }
+}
+
+// the ending search never evaluates, so the feature indices are left untouched
+void Searcher::DoEndingMove(Tree& tree, const Square& move, const Bitboard& mask) {
+  tree.board.DoMove(move, mask);
+  tree.hash.DoMove(move, mask);
+  tree.ply++;
+}
+
+void Searcher::UndoEndingMove(Tree& tree, const Square& move, const Bitboard& mask) {
+  tree.board.UndoMove(move, mask);
+  tree.hash.UndoMove(move, mask);
+  tree.ply--;
+}
+
+Score Searcher::Evaluate(Tree& tree) {
+  // both the hash and the evaluation are relative to the side to move
+  const uint64_t hash = tree.hash.Get();
+  std::atomic<uint64_t>* entry = nullptr;
+  if (evalCache_) {
+    tree.evalCacheProbes++;
+    entry = &evalCache_[hash & evalCacheMask_];
+    const uint64_t cached = entry->load(std::memory_order_relaxed);
+    if (((cached ^ hash) >> 16) == 0) {
+      tree.evalCacheHits++;
+      return static_cast<Score>(static_cast<uint16_t>(cached));
+    }
+  }
+
+  Score score;
+  if (tree.network != nullptr) {
+    score = tree.network->Evaluate(tree.accumulator);
+  } else {
+    score = eval_->Evaluate(tree.features) + eval_->EvaluateGlobal(tree.board);
+  }
+
+  if (entry != nullptr) {
+    entry->store((hash & ~uint64_t(0xffff)) | static_cast<uint16_t>(score), std::memory_order_relaxed);
+  }
+  return score;
+}
+
 void Searcher::GenerateEndingMoves(Tree& tree, Score alpha, Score beta) {
   Node& node = tree.stack[tree.ply];
   node.nmoves = 0;
@@ -335,10 +612,8 @@ void Searcher::GenerateEndingMoves(Tree& tree, Score alpha, Score beta) {
     return;
   }
 
-  for (Square move = Square::Begin(); move != Square::End(); move = move.Next()) {
-    if (moves.Get(move)) {
-      node.moves[node.nmoves++] = { move, 0 };
-    }
+  for (Square move : moves) {
+    node.moves[node.nmoves++] = { move, 0 };
   }
 }
 
@@ -352,10 +627,8 @@ void Searcher::GenerateMoves(Tree& tree, Square ttMove, int depth, Score alpha,
     return;
   }
 
-  for (Square move = Square::Begin(); move != Square::End(); move = move.Next()) {
-    if (moves.Get(move)) {
-      node.moves[node.nmoves++] = { move, 0 };
-    }
+  for (Square move : moves) {
+    node.moves[node.nmoves++] = { move, 0 };
   }
 
   if (node.nmoves <= 1) {
@@ -386,11 +659,10 @@ void Searcher::GenerateMoves(Tree& tree, Square ttMove, int depth, Score alpha,
       continue;
     }
 #endif
-    Bitboard mask = tree.board.DoMove(node.moves[mi].move);
-    tree.ply++;
+    Bitboard mask = tree.board.GetFlipMask(node.moves[mi].move);
+    DoMove(tree, node.moves[mi].move, mask, tree.hash.GetChild(node.moves[mi].move, mask));
     node.moves[mi].score = -Search(tree, newDepth, -beta, -alpha, false);
-    tree.board.UndoMove(node.moves[mi].move, mask);
-    tree.ply--;
+    UndoMove(tree, node.moves[mi].move, mask);
   }
   
   std::sort(node.moves, node.moves + node.nmoves, [](const Move& lhs, const Move& rhs) {
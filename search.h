@@ -2,6 +2,7 @@
 
 #include "reversi.h"
 #include "evaluate.h"
+#include "network.h"
 #include <atomic>
 #include <random>
 #include <memory>
@@ -39,12 +40,18 @@ struct SearchResult {
   bool ending;
 };
 
+struct SearchStatistics {
+  uint64_t nodes;
+  uint64_t evalCacheProbes;
+  uint64_t evalCacheHits;
+};
+
 class SearchHandler {
 public:
-  virtual void OnIterate(int depth, const PV& pv, Score score, int nodes) = 0;
-  virtual void OnFailHigh(int depth, Score score, int nodes) = 0;
-  virtual void OnFailLow(int depth, Score score, int nodes) = 0;
-  virtual void OnEnding(const PV& pv, Score score, int nodes) = 0;
+  virtual void OnIterate(int depth, const PV& pv, Score score, uint64_t nodes) = 0;
+  virtual void OnFailHigh(int depth, Score score, uint64_t nodes) = 0;
+  virtual void OnFailLow(int depth, Score score, uint64_t nodes) = 0;
+  virtual void OnEnding(const PV& pv, Score score, uint64_t nodes) = 0;
 };
 
 class Searcher {
@@ -53,11 +60,37 @@ public:
   constexpr static int DepthOnePly = 1;
   constexpr static int TTSize        = 0x100000;
   constexpr static int TTMask        = 0x0fffff;
+  constexpr static size_t DefaultEvalCacheSize = 0x1000;
 
-  Searcher(const std::shared_ptr<Evaluator>& eval, SearchHandler* handler = nullptr);
+  // evalCacheSize is the number of the entries of the evaluation cache,
+  // which is rounded down to a power of 2, and 0 disables the cache.
+  Searcher(const std::shared_ptr<const Evaluator>& eval, SearchHandler* handler = nullptr,
+           size_t evalCacheSize = DefaultEvalCacheSize);
 
   SearchResult Search(const Board& board, int depth, int endingDepth);
 
+  // the statistics of the last search, summed over all threads
+  const SearchStatistics& GetStatistics() const {
+    return statistics_;
+  }
+
+  // The midgame search runs on threadCount threads (Lazy SMP). The helper threads search
+  // the same root on their own trees with the root moves in other orders, and every other
+  // helper starts one ply deeper. They share the transposition table and the evaluation cache,
+  // and only the main thread reports to SearchHandler and returns the result.
+  // The ending search is single-threaded.
+  void SetThreadCount(int threadCount) {
+    threadCount_ = threadCount < 1 ? 1 : threadCount;
+  }
+
+  int GetThreadCount() const {
+    return threadCount_;
+  }
+
+  // The cached evaluations are kept across searches,
+  // so the cache has to be cleared after the weights are changed.
+  void ClearEvalCache();
+
   void Reset() {
     stop_ = false;
   }
@@ -81,10 +114,18 @@ private:
   };
 
   struct Tree {
-    Board board;
+    PlayerBoard board;
+    PlayerBoardHash hash;
+    FeatureIndices features;
+    // the network of the evaluator, whose accumulator is updated instead of the features
+    const Network* network;
+    NetworkAccumulator accumulator;
     int ply;
     Node stack[64];
-    int nodes;
+    uint64_t nodes;
+    uint64_t evalCacheProbes;
+    uint64_t evalCacheHits;
+    bool helper;
   };
 
   enum TTType {
@@ -101,7 +142,40 @@ private:
     Square bestMove;
   };
 
-  void StorePV(Board board, const PV& pv, Score score);
+  // A TTElement shared by the threads without locks. The data is packed into one word,
+  // and the key is the hash xor the data, so an entry torn by concurrent stores never matches.
+  struct TTEntry {
+    std::atomic<uint64_t> key;
+    std::atomic<uint64_t> data;
+  };
+
+  TTElement LoadTT(uint64_t hashKey) const;
+
+  void StoreTT(uint64_t hashKey, const TTElement& elem);
+
+  void InitTree(Tree& tree, const Board& board, bool helper);
+
+  // the iterative deepening from firstDepth, where the moves of the root are already generated
+  void Iterate(Tree& tree, int firstDepth, int maxDepth);
+
+  bool IsStopped(const Tree& tree) const {
+    return stop_.load() || (tree.helper && helperStop_.load());
+  }
+
+  void StorePV(PlayerBoard board, const PV& pv, Score score);
+
+  // childHash is tree.hash.GetChild(move, mask)
+  void DoMove(Tree& tree, const Square& move, const Bitboard& mask, uint64_t childHash);
+
+  void UndoMove(Tree& tree, const Square& move, const Bitboard& mask);
+
+  void DoEndingMove(Tree& tree, const Square& move, const Bitboard& mask);
+
+  void UndoEndingMove(Tree& tree, const Square& move, const Bitboard& mask);
+
+  void Pass(Tree& tree);
+
+  Score Evaluate(Tree& tree);
 
   Score SearchEnding(Tree& tree, Score alpha, Score beta, bool passed);
 
@@ -112,10 +186,22 @@ private:
   void GenerateMoves(Tree& tree, Square ttMove, int depth, Score alpha, Score beta);
 
   std::atomic<bool> stop_;
+
+  // stops the helpers when the main thread finishes
+  std::atomic<bool> helperStop_;
+
   std::mt19937 random_;
-  const std::shared_ptr<Evaluator> eval_;
+  const std::shared_ptr<const Evaluator> eval_;
   SearchHandler* handler_;
-  std::unique_ptr<TTElement[]> tt_;
+  std::unique_ptr<TTEntry[]> tt_;
+  int threadCount_;
+
+  // [hash & evalCacheMask_] => the upper 48 bits of the hash and the score in the lower 16 bits,
+  // in a single word so that an entry is never torn
+  std::unique_ptr<std::atomic<uint64_t>[]> evalCache_;
+  uint64_t evalCacheMask_;
+
+  SearchStatistics statistics_;
 
 };
 
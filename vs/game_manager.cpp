@@ -170,33 +170,33 @@ void GameManager::ComTurn() {
 void GameManager::OnTurn() {
   Bitboard moves = board_.load().GenerateMoves();
   handler_->OnLog("Moves: ");
-  for (Square square = moves.Pick(); !square.IsInvalid(); square = moves.Pick()) {
+  for (Square square : moves) {
     handler_->OnLog(square.ToString());
   }
   handler_->OnLog("\r\n");
 }
 
-void GameManager::OnIterate(int depth, const PV& pv, Score score, int nodes) {
+void GameManager::OnIterate(int depth, const PV& pv, Score score, uint64_t nodes) {
   char buf[1024];
-  wsprintf(buf, "Depth %2d: %8d: %s: %d\r\n", depth, nodes, pv.ToString(), score);
+  wsprintf(buf, "Depth %2d: %8I64u: %s: %d\r\n", depth, nodes, pv.ToString(), score);
   handler_->OnLog(buf);
 }
 
-void GameManager::OnFailHigh(int depth, Score score, int nodes) {
+void GameManager::OnFailHigh(int depth, Score score, uint64_t nodes) {
   char buf[1024];
-  wsprintf(buf, "Depth %2d: %8d: fail-high: %d\r\n", depth, nodes, score);
+  wsprintf(buf, "Depth %2d: %8I64u: fail-high: %d\r\n", depth, nodes, score);
   handler_->OnLog(buf);
 }
 
-void GameManager::OnFailLow(int depth, Score score, int nodes) {
+void GameManager::OnFailLow(int depth, Score score, uint64_t nodes) {
   char buf[1024];
-  wsprintf(buf, "Depth %2d: %8d: fail-low: %d\r\n", depth, nodes, score);
+  wsprintf(buf, "Depth %2d: %8I64u: fail-low: %d\r\n", depth, nodes, score);
   handler_->OnLog(buf);
 }
 
-void GameManager::OnEnding(const PV& pv, Score score, int nodes) {
+void GameManager::OnEnding(const PV& pv, Score score, uint64_t nodes) {
   char buf[1024];
-  wsprintf(buf, "Ending: %8d: %s: %d\r\n", nodes, pv.ToString(), score);
+  wsprintf(buf, "Ending: %8I64u: %s: %d\r\n", nodes, pv.ToString(), score);
   handler_->OnLog(buf);
 }
 
@@ -3,6 +3,7 @@
 #include <atomic>
 #include <random>
 #include <ctime>
+#include <string>
 
 namespace beluga {
 
@@ -52,11 +53,19 @@ public:
       eval_(new Evaluator),
       searcher_(eval_, this),
       random_(static_cast<unsigned>(time(nullptr))) {
-    auto err = eval_->LoadParam();
+    // the old format cannot be mapped, and is loaded into memory
+    auto err = eval_->MapParam();
+    if (err != nullptr) {
+      err = eval_->LoadParam();
+    }
     if (err != nullptr) {
       MessageBox(NULL, err, "beluga", MB_OK | MB_ICONERROR);
       ExitProcess(1);
     }
+    // "beluga.exe --quantized" evaluates with the int8 weights trained by "learn quantized"
+    if (std::wstring(GetCommandLineW()).find(L" --quantized") != std::wstring::npos) {
+      eval_->Quantize();
+    }
   }
 
   void Start(const GameSetting& setting);
@@ -103,10 +112,10 @@ public:
   }
 
   void OnTurn();
-  void OnIterate(int depth, const PV& pv, Score score, int nodes);
-  void OnFailHigh(int depth, Score score, int nodes);
-  void OnFailLow(int depth, Score score, int nodes);
-  void OnEnding(const PV& pv, Score score, int nodes);
+  void OnIterate(int depth, const PV& pv, Score score, uint64_t nodes);
+  void OnFailHigh(int depth, Score score, uint64_t nodes);
+  void OnFailLow(int depth, Score score, uint64_t nodes);
+  void OnEnding(const PV& pv, Score score, uint64_t nodes);
 
 private:
 
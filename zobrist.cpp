@@ -1,609 +1,135 @@
 #include "zobrist.h"
 
-const uint64_t ZobristTable1[16] = {
-  0x17b17c12beec384cll,
-  0x97b166b3dd39652ll,
-  0xcb72fe812e60e070ll,
-  0x6e3b8ba4c98e391ell,
-  0x16ca2489b3a7a0ell,
-  0xceb47ed87764a014ll,
-  0xf528cee6b9996d92ll,
-  0x126d157115ce5e6ell,
-  0x729924b0bf4aebc4ll,
-  0xf66df9d58b74ecacll,
-  0x785edf49897ec2fcll,
-  0xd760bfeb06b412f0ll,
-  0xa92bd51ba0c85400ll,
-  0xe72f6bac0a7fbf96ll,
-  0x403dcc0f8aae894ll,
-  0x6b6da8dd898c2acell,
-};
-
-const uint64_t ZobristTable2[16] = {
-  0x3e9824c2b17a0756ll,
-  0xa7afa85efe192706ll,
-  0x7b12aac8b5da4a6all,
-  0xd09802023eacf0cll,
-  0x1fb7c72f68668a9cll,
-  0x7a48c69bc339a156ll,
-  0xa4c3a2d2af24ed7all,
-  0xaf9022cd2b20cc24ll,
-  0x509684b3b901fc66ll,
-  0x875c4e69cb0e5f6ell,
-  0x71821777dbd3a02cll,
-  0x63094093fece360ell,
-  0x3b9f1a19b1dabe84ll,
-  0x80383052c9b837dcll,
-  0x738337b3767a1cf6ll,
-  0x62eb0f1cda0a9dcall,
-};
-
-const uint64_t ZobristTable3[16] = {
-  0x5c12388401701f76ll,
-  0x87e31260e16badaall,
-  0xf2c310de6e4d920all,
-  0xdb6847021455c2acll,
-  0xc38f1c11969ac3eell,
-  0x5919b5ca966980e6ll,
-  0xacf33bb12a452682ll,
-  0x4b7b18cdbc01f1d0ll,
-  0x69a7634dcb6a2c16ll,
-  0xf0eb97e38b8e47all,
-  0x2f7ba90fac863d60ll,
-  0x1707fa2c6db696a4ll,
-  0x6aca871dbee8afb4ll,
-  0x824b1acd8170a6cll,
-  0x17882e5e418075e4ll,
-  0xb86994a3dd7be288ll,
-};
-
-const uint64_t ZobristTable4[16] = {
-  0x184551c80043b2ball,
-  0xba1f39c5b17e7884ll,
-  0xcc2893fb6a6514c0ll,
-  0xe2640d09edb3745cll,
-  0x54f74e6d1d8f1930ll,
-  0x2dccb4627533cfe0ll,
-  0x9bc2e1b39ad83054ll,
-  0xc21c60541fe7180all,
-  0x3d334d7879f88318ll,
-  0x672e90156ef68262ll,
-  0x6c9fa9cf60e54caall,
-  0x58ceae42d9ce4f96ll,
-  0x4670a51a30fab8e0ll,
-  0x6c667f29bf7e1ca2ll,
-  0xf873f04db1f348ell,
-  0x91da55527eae408ell,
-};
-
-const uint64_t ZobristTable5[16] = {
-  0xdfc0108e9d4035a4ll,
-  0x53769e49c9481d2cll,
-  0x57c9fd1efeda6e2ell,
-  0x4cc297435b7996all,
-  0xc9ee060445645c64ll,
-  0x125b6ce3c6198cd0ll,
-  0xce1448c836856f36ll,
-  0x30d5ebcdf00bdf0all,
-  0x5dc87c8561e46702ll,
-  0x37ab07d5c39bea1ell,
-  0xfdf658a99f37936ll,
-  0x14044350918dfcc2ll,
-  0x56a94aabbb4ce90ll,
-  0x8c7fb230241a5d70ll,
-  0xa1bb93e398c5d24ll,
-  0x57b0feac8e57f6f6ll,
-};
-
-const uint64_t ZobristTable6[16] = {
-  0xbb74ac6f7c78b5b0ll,
-  0xf70603eb0939156cll,
-  0x3c95c12bda3c06fall,
-  0x3ac13ca15c5c6daall,
-  0x8de576ddc57e8ba0ll,
-  0xcb69638d86e18056ll,
-  0x957f07c6fa171b5ell,
-  0x970f141a88230422ll,
-  0x47df5c0a7571c5e8ll,
-  0x3a1c0eafe1f33328ll,
-  0x68c9827ce09cf3aall,
-  0xd9215438cc1b66b2ll,
-  0x6dc6e78a54515cd8ll,
-  0x3adb038e88d7569all,
-  0x2c70330208d81474ll,
-  0xfe70b7e28d75aae8ll,
-};
-
-const uint64_t ZobristTable7[16] = {
-  0x1e2978a158dd2172ll,
-  0xcb4035cd0e41c08ell,
-  0xfd71004c8da8caa4ll,
-  0x7003350382f06e44ll,
-  0x7396826c700dff36ll,
-  0x359d6b92b0e735b4ll,
-  0x4853cf5ec52d33c4ll,
-  0x3c1a99757df9a9f0ll,
-  0x6f2927e8b58723e2ll,
-  0xa91cf3a1213db742ll,
-  0xb05a085fb8132316ll,
-  0x1dd1eaa7094c18b8ll,
-  0xe9f895fc486f9d7ell,
-  0x2ff1ab9a26704cfall,
-  0xa9e04557917e6014ll,
-  0x9dd0b25d989b445ell,
-};
-
-const uint64_t ZobristTable8[16] = {
-  0xac6b3c1a134eddb2ll,
-  0xe185a023a8b8b316ll,
-  0x245e796a6df712c8ll,
-  0x2d9ec989265c6a36ll,
-  0x63ab8240defd840all,
-  0xd5a5211b70a073e6ll,
-  0x862b731bf9fc2094ll,
-  0xd9245b015e1a9dfcll,
-  0xd515e941f7aa820ell,
-  0x93a897ee70e50852ll,
-  0x690789617563124all,
-  0xe852882b0edd776cll,
-  0xb10993a30cca3c72ll,
-  0xb5e4169f2e628e9cll,
-  0xb2f8158a50d27012ll,
-  0x33140c121d763a92ll,
-};
-
-const uint64_t ZobristTable9[16] = {
-  0x2d8524088491681cll,
-  0x55f47be460876990ll,
-  0x357fcb3c45f21bf2ll,
-  0x3025dae7eeb03e7cll,
-  0xa7654bba27e952a6ll,
-  0xaecb9f64ba2dba40ll,
-  0x34d5080b4824729all,
-  0x72560ac86d37d2aell,
-  0x1ba4a4f8065aad44ll,
-  0xffe65ac7582d69a4ll,
-  0xed84683d605b6dd8ll,
-  0x62f7132c2ea78830ll,
-  0x32e1a215ff34303ell,
-  0xe300f8e18ac19710ll,
-  0x5ded6a68d3ea9ef2ll,
-  0xd06426a59d451116ll,
-};
-
-const uint64_t ZobristTable10[16] = {
-  0xfe003df24d8b282ll,
-  0x3cbd07b3a507f24ell,
-  0xb77d4454311375d0ll,
-  0x4ba22dcde55023b4ll,
-  0x98c9c4e0582cc81ell,
-  0x2877a71959b4f982ll,
-  0x42fe50102c839e16ll,
-  0x6ddd0c5311473004ll,
-  0xca88b70a7d02ebdcll,
-  0x717dab3545c74236ll,
-  0x8166d28bd31edf5cll,
-  0xd387e590349821d0ll,
-  0x4a01b6a8e6421f6cll,
-  0x2cb1782c135ead82ll,
-  0x9e45054a76e50c44ll,
-  0x464c722b8c55c8b2ll,
-};
-
-const uint64_t ZobristTable11[16] = {
-  0x9493005e1572e4dall,
-  0x641191f28db713f2ll,
-  0x50ed92aa5e0832dcll,
-  0x4473c8d52dba8a48ll,
-  0x24f7b03e8e9e7a70ll,
-  0xd2dff860d29f7984ll,
-  0xa7e8fcad9004883all,
-  0xe1f12286e675ffball,
-  0x98a46f2c11fa451cll,
-  0x564038f1ed6bbf04ll,
-  0xe9a5abcea92986b2ll,
-  0x98c5180b6204f7f8ll,
-  0xa5d4338ffaf52f64ll,
-  0xd946dc4f544074fall,
-  0xb479090839e376a4ll,
-  0x9adc08c2cd381eb2ll,
-};
-
-const uint64_t ZobristTable12[16] = {
-  0x73c972f91bb1fbacll,
-  0xe20e0c3250ba0214ll,
-  0xf326b3a4f76a6cbcll,
-  0xc4882bcd9dc182ecll,
-  0x1a82f13c96e4155all,
-  0x3b4b83116b032c14ll,
-  0x922411bcbc4b9a6ll,
-  0x1f0a2e69003ec2ell,
-  0x7186c47ff727e962ll,
-  0x3cbe1923961abfc6ll,
-  0x9edcfd3d20589d0cll,
-  0x85672610721dffdcll,
-  0x2f30b1872db42b22ll,
-  0x327bbba497a94292ll,
-  0x21f91c51f72572ecll,
-  0xf88b8e9e2af55fa8ll,
-};
-
-const uint64_t ZobristTable13[16] = {
-  0x21af6f16c5679592ll,
-  0x1fb9a9f71c5a4c1cll,
-  0xe27b9c73659b11dall,
-  0xc0da077951d28288ll,
-  0xd429891330162f9ell,
-  0x43f17b2640f35be6ll,
-  0x718de4b5d038160cll,
-  0x3b70b68d7223ff66ll,
-  0x72977cb1cd149790ll,
-  0xa8980c27a5924e7all,
-  0xc9528f2077d35b22ll,
-  0x81a2e0e8b6162b7cll,
-  0xced7da9f32992e62ll,
-  0xb5ced2da941e1412ll,
-  0x607e929e27d3416all,
-  0xc4cd15e9804aa9d8ll,
-};
-
-const uint64_t ZobristTable14[16] = {
-  0xae4efdde530d523all,
-  0x187e9ca6c6f550dcll,
-  0x5f1e3365d6e5c056ll,
-  0x11f3e8715d66e4c8ll,
-  0xbccf36021e5cf422ll,
-  0xa574f03ac9fc9064ll,
-  0xa7d1a7014a05858cll,
-  0xcd91aa5208278b0cll,
-  0x479c1532ed89e50cll,
-  0x50079bd93f844caall,
-  0x60be58651014fe2ll,
-  0x9db0b7b7bffbb232ll,
-  0x2eb7757da6286cf2ll,
-  0xac7645bfcf38af44ll,
-  0x144bae7a0a663470ll,
-  0x4851b9544ad18490ll,
-};
-
-const uint64_t ZobristTable15[16] = {
-  0x667c438c3d5374f0ll,
-  0xe568f15a164bdf82ll,
-  0x1c2e5275e852e3a0ll,
-  0x801ae346abf0b334ll,
-  0x6565d63c4bcac00all,
-  0xe460f380dc98e4e8ll,
-  0xf83f1d75b394cbeall,
-  0x3154a3ed4dd5b55cll,
-  0xe9944458e06ab5fall,
-  0x1b95cd04ce6c3880ll,
-  0x1268ed3ca696d854ll,
-  0x7eb7345856f08500ll,
-  0x64b57ec3e0c0e19ell,
-  0xe9ab2d08ec8d755ell,
-  0x400e3e535e3ccedell,
-  0x4a3beac379607f22ll,
-};
-
-const uint64_t ZobristTable16[16] = {
-  0x5eef230d63f79724ll,
-  0x56201dfaa83cd54ell,
-  0xb4fe7e27355b6590ll,
-  0xc1ca912d37ba665all,
-  0x1a27bd0024078e54ll,
-  0xc8d70be2a04a5f1ell,
-  0xc35050708cd0b0cell,
-  0x2f37cf53ee5873dcll,
-  0x60293879417c3c2all,
-  0x66a3b150150926dcll,
-  0xa42711ce94f3a716ll,
-  0xc1fa473dd66f8ff6ll,
-  0xd57d4a81f8a66398ll,
-  0x74ea0a5943a1643all,
-  0x567319282de724aell,
-  0x150729d9d7151afall,
-};
-
-const uint64_t ZobristTable17[16] = {
-  0xe7734347b4f65210ll,
-  0xb6f9b30e63475c68ll,
-  0x77a83f9a8a97992ll,
-  0xd3c2da746ffcf69ell,
-  0xd73a08641cfd9b64ll,
-  0x6b27f3ca27cff6ball,
-  0xa73dfdfc2c812e00ll,
-  0xd63cce9d2b1e2f38ll,
-  0x3eb61be7db2bff98ll,
-  0x3c170efa6bebcb98ll,
-  0x7d5bb566eaad0bbell,
-  0xe3a61025155f1a4all,
-  0x86aca13edc4e18all,
-  0xc5b37184ddbb9c48ll,
-  0xd1fb103603d7a89cll,
-  0x55ab3f741ac1b630ll,
-};
-
-const uint64_t ZobristTable18[16] = {
-  0xc993dba907a85fb0ll,
-  0xb1f9ec11b3743e62ll,
-  0xcf6b8e38c44c2290ll,
-  0xb8c8c7024dda69c2ll,
-  0xd47aa460597f6340ll,
-  0xab9074d0fcddbdc8ll,
-  0xde5b97a26c9a9494ll,
-  0x75f4b4336efe6630ll,
-  0xa7f1385f82bd119all,
-  0xbcac33320922ab82ll,
-  0xdb7f1325d4c3ebb6ll,
-  0x3e8d628e266cae3ell,
-  0xd0c1c7a5bb62c838ll,
-  0x6594490e16246b1all,
-  0x4be48435f8bbc7f6ll,
-  0x394fd58a816a4dccll,
-};
-
-const uint64_t ZobristTable19[16] = {
-  0x14a80dbb06eb9476ll,
-  0xe27f54d199d0cbb6ll,
-  0x2298447b2bfd49ball,
-  0xf33324befc39de16ll,
-  0x7391b2c60d276632ll,
-  0xac3d903398ac5624ll,
-  0x811841fa16f34926ll,
-  0x4b39c4f5f81d654ell,
-  0x6ca7323b350f1090ll,
-  0xa6a015f02f56184all,
-  0x160540e8ae819bbcll,
-  0x5bffb83c2aec5dc8ll,
-  0xf112cd1e6dba1612ll,
-  0xbb2a39f1a5969d26ll,
-  0xfc7e2c81515bea12ll,
-  0x12dbb86197205b2all,
-};
-
-const uint64_t ZobristTable20[16] = {
-  0x1f396fbcb106a600ll,
-  0xe04fbb842d5e9a9all,
-  0xeb99bdec59f27c72ll,
-  0x3e7265f851087c26ll,
-  0x695efcf7bbb37e44ll,
-  0xb85bd62ea764233all,
-  0x4bbfa2dcadd2e614ll,
-  0x5770c41d18323fa4ll,
-  0x223b5cf7af5034dell,
-  0x192960b6a31ecef4ll,
-  0x96b159c59c6dc18ell,
-  0x544dfffa9490ed98ll,
-  0xf7e4654f5ef78cc6ll,
-  0x2eaf02f5a5dd05c2ll,
-  0x3aef25cd12880b7ell,
-  0x7e1ad6beceafd78ll,
-};
-
-const uint64_t ZobristTable21[16] = {
-  0xc614cbd8cf1531f0ll,
-  0xc9c6c083000b3628ll,
-  0x30f5e71c182f2022ll,
-  0x5725dd0f3c2da040ll,
-  0xf5580f29473ab878ll,
-  0xa1f34569d54cb282ll,
-  0xa7dcbcdd373cd962ll,
-  0xa28652e527091eccll,
-  0x16b5322d2dcb1fdell,
-  0x5c96c76975b442bell,
-  0xe06e45b27ae30850ll,
-  0x54bc481eba8fcf0ell,
-  0x22ab3a4ade213e5ell,
-  0x696b0b1b699b0c8ell,
-  0x4e61cc7159a4141ell,
-  0x51b1f2d1974a3638ll,
-};
-
-const uint64_t ZobristTable22[16] = {
-  0xc69fe7dc4e0f37d4ll,
-  0xbc7a13e57d6a2502ll,
-  0xdd26b3804be24290ll,
-  0x74047b86e78b0e2all,
-  0x7c6bb3560b03dcaell,
-  0x3948d9823f7a21d2ll,
-  0x496fb857f7ec1530ll,
-  0xd72fc3e0ab847e5all,
-  0x76ea1c15f1145b0ll,
-  0xab7bcf07863ed004ll,
-  0xccc5cb54c105b74cll,
-  0xcec5427ee5517a0all,
-  0xc4ec56e713bd4a94ll,
-  0xaef114fe8bf2195cll,
-  0xaba461cf275f6a34ll,
-  0xc104505db2d9223cll,
-};
-
-const uint64_t ZobristTable23[16] = {
-  0x89a510166aac67b0ll,
-  0xf4131c15f7491904ll,
-  0x84bb40de86af5a26ll,
-  0xe37df17aa7587dd8ll,
-  0x395e075678d1aff8ll,
-  0xa4a411e16fdcd8a0ll,
-  0x68f6eeeb9ce5cff2ll,
-  0x3432e56b8dd96936ll,
-  0x452173669ff03842ll,
-  0xe80b6ca510316846ll,
-  0x6b40a5887aa5c898ll,
-  0x1656edd226cac8dcll,
-  0x6a6dd65093b5bd2ell,
-  0x53e8bb89347461a2ll,
-  0x53d9a07da981d6cll,
-  0x183b54ec1877a6b2ll,
-};
-
-const uint64_t ZobristTable24[16] = {
-  0x94f7e8d09b4f3b24ll,
-  0xf326ffd0fd3b71e8ll,
-  0xeb673e35b0b707acll,
-  0xc394e4e6aa13d360ll,
-  0x7701219612f20168ll,
-  0x7a5962003ecd6062ll,
-  0x817dd828f7cc702all,
-  0x2a13b31f870f6e86ll,
-  0xac143a5e83876ef0ll,
-  0x39f561bcbbc62284ll,
-  0x6d6d6bcd56b5e4f8ll,
-  0xf6d92757cd71be92ll,
-  0xed0861c9d79b4118ll,
-  0x952c913d5c6b93f4ll,
-  0x37c9ba66dddd462ll,
-  0x1e061d234c685f68ll,
-};
-
-const uint64_t ZobristTable25[16] = {
-  0x2ef435e18ca1a1e8ll,
-  0x378a6c1fc8f1558ell,
-  0x2183a91e9e6825d4ll,
-  0x4337332aa542a24all,
-  0x3724867c8c0e6b64ll,
-  0x3d85b767a9e10adall,
-  0x426fe8ae8bed8c26ll,
-  0xec99dea006b5cc40ll,
-  0x9ae5f59c3d2a64d8ll,
-  0x76ad563d565f37fall,
-  0x1021c50f79d0bf24ll,
-  0x44b47df0a8accc02ll,
-  0x93c697e3574bd1all,
-  0xb8cad5e8ac4598c0ll,
-  0xca02e74458b78aeall,
-  0xa37a28d117bc689cll,
-};
-
-const uint64_t ZobristTable26[16] = {
-  0x111c1c85e449eadell,
-  0xca148fb8f8afeb1cll,
-  0x6f297fc9defbf6c8ll,
-  0xa5efd62b03a52e88ll,
-  0x761423318d8d4d8ll,
-  0xda3cb149f9ee89d6ll,
-  0xd11b6adccb6ad058ll,
-  0x84962db9f0468af8ll,
-  0x4f8cb59b99849694ll,
-  0x66d733bbef19c95cll,
-  0x6b1ff77a3373c4c4ll,
-  0xcc9fee8c46d3ce90ll,
-  0xd73dcc4042041078ll,
-  0xafbb4413bfc9608cll,
-  0x9945abab134cb158ll,
-  0x2cb4b0a07a374ecall,
-};
-
-const uint64_t ZobristTable27[16] = {
-  0xe1e594f4e81693a0ll,
-  0xaa8dea87148c4f34ll,
-  0xcad15abc59f137c2ll,
-  0xd81d47778ea046aall,
-  0x3be90f4f857c57c0ll,
-  0xac71180ae97a57e0ll,
-  0xbdc46d3d478bcb0ell,
-  0x8232725bd39d9a1cll,
-  0x8ac7db61d74fedfall,
-  0x96dfc9cb70914d22ll,
-  0x38b237afdb0d42ell,
-  0xf797770fb5beb4d2ll,
-  0x2089af65b5d35124ll,
-  0x3624765ab645d82ell,
-  0x17e47c3f09b8b8dcll,
-  0x84267441bcc13e0cll,
-};
-
-const uint64_t ZobristTable28[16] = {
-  0x1ace2f9d6214ac94ll,
-  0xf247bd2e533f6f02ll,
-  0x78e52a0de212bea8ll,
-  0xaf86662e65e4a0a0ll,
-  0x2fc06279173b7c32ll,
-  0xe52a40cbd12b57aell,
-  0xe19a8a02a31c5078ll,
-  0x7c14d7f316047f5ell,
-  0xfbfdd78713424d98ll,
-  0xf8f6ddab41eafc0all,
-  0xf156d977f25aeb64ll,
-  0x38c80749709ce87ell,
-  0xfd87242f0104b29all,
-  0xffd904ffb2130432ll,
-  0xf14f010c4cdd3c18ll,
-  0xf457c417210636cll,
-};
-
-const uint64_t ZobristTable29[16] = {
-  0xdf4f770cf80072eall,
-  0x2eb83b1a0c40a9c4ll,
-  0x75440769afa7d69all,
-  0xa63a63534a5d4848ll,
-  0x80e2912693be1d0ll,
-  0x70746c0c4644b2dcll,
-  0x385c857d9347d75ell,
-  0xdc0646e71cc684eell,
-  0x488f2a7218465174ll,
-  0x346320ece3a26cf6ll,
-  0x94b85b99a331bbc6ll,
-  0xbdbccbd5d0ed09b6ll,
-  0x45bb2920265defdall,
-  0xaec06698cbfda9fcll,
-  0x19963a0d55813df8ll,
-  0xac4b4ad0416fa4e0ll,
-};
-
-const uint64_t ZobristTable30[16] = {
-  0x2ec4e254b1451a30ll,
-  0xbbfbf8165cd268a2ll,
-  0x946abc445ce37798ll,
-  0xfe7230b0ae939040ll,
-  0xf43b68fd8f3d13eall,
-  0x1a5053314a874b44ll,
-  0x971994fc3da66a7cll,
-  0x2d228105037b3a34ll,
-  0xee95c22d9f653644ll,
-  0x2960289f16cc75dcll,
-  0xeb36975474a8f728ll,
-  0x26056cd9395ed806ll,
-  0x2d82713223e61314ll,
-  0x1c8fa4593fcf75ell,
-  0xa84e3c0597f9ee38ll,
-  0xc02f9667b96cf0d0ll,
-};
-
-const uint64_t ZobristTable31[16] = {
-  0x7ea56c12fa96d7fell,
-  0xf33f6b8e116c48a4ll,
-  0xa34a2a50600a4886ll,
-  0x4790a1b7486cf242ll,
-  0x21f1df11e0c09cbcll,
-  0xf3538d45cfef4d6ell,
-  0x1ab4aa561bb78548ll,
-  0x90e9d51c4c44a9eall,
-  0x33b13add86b88e2cll,
-  0xaa96627dbe3c0022ll,
-  0x52fb0bdc7f4db1ecll,
-  0x64b4579fb33e97dell,
-  0x66383d2340be9ceell,
-  0xe85d39f2edcae1d8ll,
-  0x72918d799e88e618ll,
-  0x289499ad0d7138all,
-};
-
-const uint64_t ZobristTable32[16] = {
-  0xd696182484d03190ll,
-  0xf050f80e0a47a440ll,
-  0xd17e6dda49a18070ll,
-  0xbb0c1954b461e182ll,
-  0x8fb01d75d7976ecll,
-  0x6305896e74813542ll,
-  0xff184c7ae6c2a1a0ll,
-  0x5d9ef80f5eaaf428ll,
-  0xad8e675baf733d16ll,
-  0x10c559d010c6c96all,
-  0xa7d71e30e7191836ll,
-  0xfa4a2f3f00b0748ll,
-  0xdb37c2916dbd6396ll,
-  0xcca4d125b3b58e36ll,
-  0x5328b50dced3754ell,
-  0x368516462cdc6bf8ll,
+const uint64_t ZobristPlayerTable[64] = {
+  0xfe2e25e6fd9dc0edllu,
+  0x0063db99e221bf6bllu,
+  0x9f6f19cd97c22cabllu,
+  0x9eccd937ec6df101llu,
+  0x53e352577cd0b91bllu,
+  0xf74193790e58e22fllu,
+  0x8fcf01534c935565llu,
+  0x2640177509081f5cllu,
+  0x6115e5eff996fe5bllu,
+  0xcc6951e0deba4d3bllu,
+  0x6c3961e9ff754afallu,
+  0xa0de9bd59a2b0ebcllu,
+  0x70d36fe0d743e2e0llu,
+  0xdcad296a9b49b006llu,
+  0xca2288447f47dda0llu,
+  0xd159c7fa98257b62llu,
+  0x37acb77c3f88d728llu,
+  0x5a69d04857248230llu,
+  0x4d68f2105c35fda2llu,
+  0xa3bf5fafc365092dllu,
+  0xfd40510e07aa0e8ellu,
+  0xba7acff80cbf695cllu,
+  0x4f93f303d4136cc9llu,
+  0xdca49783373f673allu,
+  0x2e901f7610b5b6b9llu,
+  0xdb4b5d21f90b06e0llu,
+  0x3a751ecc7d90f1a1llu,
+  0x24f392f5ce8b341cllu,
+  0x94e214a2ef4a7e40llu,
+  0xbbe062e078be7866llu,
+  0x8ebd1419f5382ba9llu,
+  0xc36940163f7ed88allu,
+  0x9d001c00827814bcllu,
+  0x7f46cf48cbd9cd21llu,
+  0x6a2881805b1ec205llu,
+  0x4d845572fb27ed36llu,
+  0x31dfb5f3dc57cc27llu,
+  0xf04a45cb982a10a3llu,
+  0xa936ac2a9a4fad1dllu,
+  0xb12233cdc7c0b059llu,
+  0x3ffe125dd6e723b4llu,
+  0xdac1025824019256llu,
+  0x74170892d5f0d948llu,
+  0x008ecde4c4d17e35llu,
+  0x3fd8ff523410e9d6llu,
+  0x360e74504ff4f419llu,
+  0x9170f724e882aac3llu,
+  0x30e31240b8a63529llu,
+  0x9eac30d76a464f9fllu,
+  0x0688557dafe46a3fllu,
+  0xee317fc464fff3d3llu,
+  0x1f454d4e5cb5e988llu,
+  0x54c9b773b2bc7a93llu,
+  0x63aff047d9a1b41fllu,
+  0xcefca82ab77973c6llu,
+  0x0e287610b4d654d1llu,
+  0xc256582ae191faf8llu,
+  0xd08d327c73845a40llu,
+  0xfdb63574f9d2545allu,
+  0xc86a9f4d891a0f0dllu,
+  0x8f65756b637a836bllu,
+  0xfc933f42dc0498fdllu,
+  0x580cb0e34d5406fellu,
+  0x7b599f390cad2f23llu,
+};
+
+const uint64_t ZobristOpponentTable[64] = {
+  0x6d678158f6d5f5c5llu,
+  0x907be2682b37619dllu,
+  0xcfac2231f82ca14bllu,
+  0xd6d96f27a3df054allu,
+  0x342a07d877d677d8llu,
+  0x8b6518c5c18ea33allu,
+  0x640da547191557cellu,
+  0x15ecc5e54d9aa306llu,
+  0xb90623eaf601602allu,
+  0xa95dc141c6636f7allu,
+  0xe1c1f5adcea714cdllu,
+  0x15e49c911c48e6e6llu,
+  0xb484b6f280c2c3d1llu,
+  0x74aaf080b4f02e72llu,
+  0xa38bc15eec94edafllu,
+  0x4b5a4992867fac1fllu,
+  0xf2c03eb42d43fd23llu,
+  0x700194b52bc83a24llu,
+  0x833570404b22b57bllu,
+  0xaa74e13dc5f57c27llu,
+  0x597eea87692356dallu,
+  0x5f462b295a667264llu,
+  0xe6e0d85f325b5b97llu,
+  0x51d74c46e43c8ddcllu,
+  0x33fc52402ffc84a4llu,
+  0x2bad62e6f5c9a9callu,
+  0x3a8c221f8d9465f9llu,
+  0xd66c99d908a6a782llu,
+  0xb0486e2acdbacf32llu,
+  0x3822bc283545e1b6llu,
+  0x988b4039e5b14ff4llu,
+  0x45ac2a45e70b7bc7llu,
+  0xa406e4d5f7ad79dallu,
+  0xeb745aa1cc0990f9llu,
+  0xc0418407db8393f0llu,
+  0x4e1e579ca2e90dc4llu,
+  0xec252e525f171763llu,
+  0x8f10b65e091f1a15llu,
+  0x2219083b31d93c5cllu,
+  0xca6bf45a15b5180cllu,
+  0xc12b996d48d2ea51llu,
+  0xb272781fec36597fllu,
+  0x28bb40fdced0198allu,
+  0xe150775dd95c975allu,
+  0xd50d616ae9681dballu,
+  0x66eb58c8d211e3b3llu,
+  0xf1c7f0a4b2f2b3bfllu,
+  0xfcfacfae8147fa1allu,
+  0xeda7a7de448e6e61llu,
+  0xea96822c1de4b35ellu,
+  0x616b83bca0acbbf8llu,
+  0x8b9127ece1dc951dllu,
+  0xf7c0957cfc3abfdellu,
+  0x9b5743d1cbe28f7ellu,
+  0x1aadf8ac33dc0d64llu,
+  0x0ab75fef1e566620llu,
+  0x833f6e6b926439dbllu,
+  0xd385e802ee38b42bllu,
+  0xf3d3626ac8135fe6llu,
+  0x22f4868be63a68c0llu,
+  0x4554f54a0c9b1ba8llu,
+  0x56238248621cca30llu,
+  0x61be059dcff356d7llu,
+  0xd3bdd9811f85b1ffllu,
 };
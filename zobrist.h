@@ -2,35 +2,6 @@
 
 #include <cstdint>
 
-extern const uint64_t ZobristTable1[16];
-extern const uint64_t ZobristTable2[16];
-extern const uint64_t ZobristTable3[16];
-extern const uint64_t ZobristTable4[16];
-extern const uint64_t ZobristTable5[16];
-extern const uint64_t ZobristTable6[16];
-extern const uint64_t ZobristTable7[16];
-extern const uint64_t ZobristTable8[16];
-extern const uint64_t ZobristTable9[16];
-extern const uint64_t ZobristTable10[16];
-extern const uint64_t ZobristTable11[16];
-extern const uint64_t ZobristTable12[16];
-extern const uint64_t ZobristTable13[16];
-extern const uint64_t ZobristTable14[16];
-extern const uint64_t ZobristTable15[16];
-extern const uint64_t ZobristTable16[16];
-extern const uint64_t ZobristTable17[16];
-extern const uint64_t ZobristTable18[16];
-extern const uint64_t ZobristTable19[16];
-extern const uint64_t ZobristTable20[16];
-extern const uint64_t ZobristTable21[16];
-extern const uint64_t ZobristTable22[16];
-extern const uint64_t ZobristTable23[16];
-extern const uint64_t ZobristTable24[16];
-extern const uint64_t ZobristTable25[16];
-extern const uint64_t ZobristTable26[16];
-extern const uint64_t ZobristTable27[16];
-extern const uint64_t ZobristTable28[16];
-extern const uint64_t ZobristTable29[16];
-extern const uint64_t ZobristTable30[16];
-extern const uint64_t ZobristTable31[16];
-extern const uint64_t ZobristTable32[16];
\ No newline at end of file
+// random keys of each square for the player's and the opponent's discs
+extern const uint64_t ZobristPlayerTable[64];
+extern const uint64_t ZobristOpponentTable[64];